@@ -3,9 +3,13 @@
 
 #include "renderer/renderer.hpp"
 #include "renderer/shaders/constant_buffers.hpp"
+#include "renderer/util/decimation.hpp"
+#include "renderer/util/frustum.hpp"
+#include "renderer/util/job_system.hpp"
 #include "renderer/util/render_vector.hpp"
 #include "renderer/vertex.hpp"
 
+#include <glm/gtc/quaternion.hpp>
 #include <glm/gtx/rotate_vector.hpp>
 #include <stack>
 
@@ -31,8 +35,34 @@ namespace renderer {
 		edge_mask = edge_all | edge_none
 	};
 
+	enum class wireframe_shape {
+		box,
+		sphere,
+		cylinder
+	};
+
+	// Indexed line list, indices come in pairs
+	struct wireframe_mesh {
+		std::vector<glm::vec3> vertices;
+		std::vector<uint32_t> indices;
+		// Bounding sphere around the origin, used for culling
+		float radius = 0.f;
+	};
+
+	struct wireframe_instance {
+		glm::vec3 center;
+		glm::vec3 scale;
+		glm::quat rotation = glm::quat(1.f, 0.f, 0.f, 0.f);
+		color_rgba col;
+	};
+
+	struct line3d {
+		glm::vec3 p1;
+		glm::vec3 p2;
+		color_rgba col;
+	};
+
 	struct shared_data {
-		glm::vec2 tex_uv_white_pixel{};
 		float curve_tesselation_tol = 0.f;
 		float circle_segment_max_error = 0.f;
 
@@ -45,16 +75,25 @@ namespace renderer {
 		constexpr static size_t circle_segment_counts_size = 64;
 		uint8_t circle_segment_counts[circle_segment_counts_size]{};
 
-		glm::vec4* tex_uv_lines = nullptr;
-
         glm::mat4x4 ortho_projection{};
 
+		// Unit box and sphere with a radius of 1, the cylinder has a radius of 1 and runs from -1 to 1 along y
+		constexpr static size_t cylinder_segments = 16;
+		std::array<wireframe_mesh, 3> wireframes;
+
+		// Sphere detail levels from coarse to fine, a sphere uses the first level whose radius in pixels is below the
+		// next threshold. The sphere in wireframes is the finest level
+		constexpr static size_t sphere_lod_count = 4;
+		constexpr static std::array<float, sphere_lod_count - 1> sphere_lod_radius = { 6.f, 20.f, 60.f };
+		std::array<wireframe_mesh, sphere_lod_count> sphere_lods;
+
 		shared_data();
 		void set_circle_segment_max_error(float max_error);
 	};
 
 	struct draw_command_header {
 		glm::vec4 clip_rect{};
+		D3D11_PRIMITIVE_TOPOLOGY topology = D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
 		ID3D11ShaderResourceView* texture = nullptr;
 		int32_t vtx_offset = 0;
 	};
@@ -68,6 +107,49 @@ namespace renderer {
 		uint32_t elem_count = 0;
 	};
 
+	enum class shape_type : uint8_t {
+		line,
+		rect,
+		rect_filled,
+		triangle,
+		triangle_filled,
+		circle,
+		circle_filled,
+		push_scissor,
+		pop_scissor,
+		push_texture,
+		pop_texture,
+		push_transform,
+		pop_transform
+	};
+
+	// A draw call recorded in deferred mode, tessellated once the render thread picks the frame up
+	struct shape_command {
+		shape_type type;
+		draw_flags flags;
+		color_rgba col;
+		// Circle segments or the index of a pushed texture
+		uint32_t segments;
+		float thickness;
+		float rounding;
+		// Corners, the center and radius of circles, the bounds of a scissor or the columns of a transform
+		glm::vec2 points[3];
+	};
+
+	static_assert(sizeof(shape_command) <= 48);
+
+	enum class marker_shape {
+		square,
+		circle,
+		diamond,
+		cross
+	};
+
+	struct point_instance {
+		glm::vec2 pos;
+		color_rgba col;
+	};
+
 	// Buffer system from
 	// https://github.com/T0b1-iOS/draw_manager/blob/4d88b2e45c9321a29150482a571d64d2116d4004/draw_manager.hpp#L76
 	class buffer {
@@ -111,9 +193,27 @@ namespace renderer {
 		void push_texture(ID3D11ShaderResourceView* srv);
 		void pop_texture();
 
+		// 2D affine transform for everything drawn while it's pushed, pushes compose with the current transform. Vertices
+		// are transformed in place whenever the transform changes or the frame is handed over, so drawing under the
+		// identity transform costs nothing. 3D primitives are placed by the projection alone and are never transformed
+		void push_transform(const glm::mat3x2& transform);
+		void pop_transform();
+		[[nodiscard]] glm::mat3x2 get_transform() const;
+		// Applies the current transform to everything drawn since it was last applied, swap_buffers calls it
+		void flush_transform();
+
+		// Geometry reservations, recorded shapes and joined forks since the last clear, zero means nothing was drawn
+		[[nodiscard]] uint64_t get_write_count() const {
+			return write_count_;
+		}
+
 		[[nodiscard]] const glm::mat4x4& get_projection() const;
 		void set_projection(const glm::mat4x4& projection);
+		// Frustum of the projection, 3D primitives are culled against it
+		[[nodiscard]] const frustum& get_frustum();
 
+		// Topology of the commands recorded from here on, changing it starts a new command so line lists and triangles
+		// can share a buffer. The 3D line primitives switch to a line list by themselves
 		[[nodiscard]] D3D11_PRIMITIVE_TOPOLOGY get_topology() const;
 		void set_topology(D3D11_PRIMITIVE_TOPOLOGY topology);
 
@@ -121,8 +221,52 @@ namespace renderer {
 
 		void clear();
 
+		// Deferred sub-lists, fork() hands out a buffer that starts with this buffer's current scissor, texture and
+		// atlas snapshots and can be recorded on another thread. join() splices every fork back in the order they were
+		// forked, the caller has to make sure the workers are done first. Forks stay owned by this buffer and are
+		// reused every frame
+		[[nodiscard]] buffer* fork();
+		void join();
+
+		// Tessellates count items in parallel, fn(buffer&, first, last) records each chunk of at most grain items into
+		// its own fork on the job system and the chunks are joined back in order
+		template<typename fn_t>
+		void record_parallel(size_t count, size_t grain, fn_t&& fn) {
+			grain = std::max<size_t>(grain, 1);
+			const size_t chunks = (count + grain - 1) / grain;
+
+			// Forked up front on this thread so the chunk order doesn't depend on which worker gets there first
+			const size_t first_fork = fork_count_;
+			for (size_t chunk = 0; chunk < chunks; chunk++)
+				(void)fork();
+
+			job_system::get_default().parallel_for(0, chunks, 1, [&](size_t first, size_t last) {
+				for (size_t chunk = first; chunk < last; chunk++)
+					fn(*forks_[first_fork + chunk], chunk * grain, std::min(count, (chunk + 1) * grain));
+			});
+
+			join();
+		}
+
+		// In deferred mode lines, rects, triangles and circles are only recorded as shape commands, along with scissor and
+		// texture changes. tessellate_shapes() turns them into vertices in parallel chunks and culls shapes outside
+		// their scissor, the renderer calls it for frames it actually draws so dropped frames are never tessellated.
+		// Deferred shapes end up on top of whatever else the frame draws
+		void set_deferred(bool deferred);
+		[[nodiscard]] bool is_deferred() const;
+		void tessellate_shapes();
+
+		// Atlas state is read from a snapshot taken once per frame so draw threads never see a rebuild in progress
+		[[nodiscard]] const font_atlas::snapshot* get_atlas_snapshot(const font_atlas* atlas);
+		[[nodiscard]] const text_font* get_font(const text_font* font);
+
 		// Primitive shapes
 		void draw_point(const glm::vec2& pos, const color_rgba& col);
+		// Every point gets the same marker, size is its width in pixels. Geometry for all of them is reserved at once and
+		// large batches are written on the job system
+		void draw_points(std::span<const point_instance> points,
+						 marker_shape shape = marker_shape::square,
+						 float size = 1.f);
 		void draw_line(const glm::vec2& p1, const glm::vec2& p2, const color_rgba& col, float thickness = 1.f);
 		void draw_rect(const glm::vec2& p1,
 					   const glm::vec2& p2,
@@ -187,6 +331,15 @@ namespace renderer {
 								 float rotation = 0.f,
 								 size_t segments = 0);
 		void draw_polyline(const glm::vec2* points, int num_points, const color_rgba& col, draw_flags flags, float thickness);
+		// For dense series, points closer than tolerance (in the units of points, before any transform) are dropped before
+		// extrusion. Min/max per column keeps the vertical extent of every column so charts look the same
+		decimation_stats draw_polyline_decimated(const glm::vec2* points,
+												 int num_points,
+												 const color_rgba& col,
+												 draw_flags flags,
+												 float thickness,
+												 float tolerance = 1.f,
+												 decimation_mode mode = decimation_mode::automatic);
 		void draw_convex_poly_filled(const glm::vec2* points, int num_points, const color_rgba& col, draw_flags flags);
 		void draw_bezier_cubic(const glm::vec2& p1,
 							   const glm::vec2& p2,
@@ -210,11 +363,18 @@ namespace renderer {
 		void draw_filled_extents(std::span<glm::vec3, 8> points, const color_rgba& col);
 		void draw_sphere(const glm::vec3& center, float radius, glm::vec3 rotation, const color_rgba& col);
 
+		// Every line, or every vertex of every instance, is written into one reservation, large batches on the job
+		// system. Meshes are line lists so they switch to a line list like draw_line(vec3) does. Instances outside the
+		// frustum or under half a pixel are skipped and spheres pick their detail level from their size on screen
+		void draw_lines3d(std::span<const line3d> lines);
+		void draw_wireframes(const wireframe_mesh& mesh, std::span<const wireframe_instance> instances);
+		void draw_wireframes(wireframe_shape shape, std::span<const wireframe_instance> instances);
+
 		template<typename string_t>
 		void draw_text(const string_t& text,
 					   glm::vec2 pos,
 					   color_rgba col = color_rgba(255, 255, 255),
-					   text_font* font = get_default_font(),
+					   const text_font* font = get_default_font(),
 					   text_flags flags = align_none) {
 			draw_text(std::basic_string_view(text), pos, col, font, flags);
 		}
@@ -223,7 +383,7 @@ namespace renderer {
 		void draw_text(std::basic_string_view<char_t> text,
 					   glm::vec2 pos,
 					   color_rgba col = color_rgba(255, 255, 255),
-					   text_font* font = get_default_font(),
+					   const text_font* font = get_default_font(),
 					   text_flags flags = align_none) {
 			if (flags & outline_text) {
 				auto cleaned_flags = flags & ~outline_text;
@@ -245,6 +405,11 @@ namespace renderer {
 				draw_text(text, { pos.x + 1, pos.y + 1 }, color_rgba(0, 0, 0, col.a), font, (text_flags)cleaned_flags);
 		    }
 
+			const font_atlas::snapshot* atlas_snapshot = font ? get_atlas_snapshot(font->container_atlas) : nullptr;
+			const text_font* snapshot_font = atlas_snapshot ? atlas_snapshot->get_font(font) : nullptr;
+			if (!snapshot_font)
+				return;
+
 			size_t vtx_count_max = text.size() * 4;
 			size_t idx_count_max = text.size() * 6;
 			size_t idx_expected_size = indices_.Size + idx_count_max;
@@ -254,10 +419,10 @@ namespace renderer {
 			uint32_t vtx_idx = vertex_current_index;
 
 			float new_line_pos = pos.x;
-			float size = font->size;
+			float size = snapshot_font->size;
 
 			if (flags != align_none) {
-				glm::vec2 text_size = font->calc_text_size<char_t>(text, size);
+				glm::vec2 text_size = snapshot_font->calc_text_size<char_t>(text, size);
 				if (text_size.x <= 0.f || text_size.y <= 0.f)
 					return;
 
@@ -277,10 +442,11 @@ namespace renderer {
 				new_line_pos = pos.x;
 			}
 
-			pos = glm::floor(pos);
+			// x stays fractional so glyphs with subpixel variants can be placed between pixels
+			pos.y = std::floor(pos.y);
 
 			const float size_reciprocal = 1.f / size;
-			const float scaled_font_size = (size / font->size);
+			const float scaled_font_size = (size / snapshot_font->size);
 			for (auto iter = text.begin(); iter != text.end();) {
 				auto symbol = (uint32_t)*iter;
 				iter += impl::char_converters::converter<char_t>::convert(symbol, iter, text.end());
@@ -297,13 +463,27 @@ namespace renderer {
 					continue;
 				}
 
-				const auto* glyph = font->find_glyph(symbol);
+				const auto* glyph = snapshot_font->find_glyph(symbol);
 				if (!glyph)
 					continue;
 
 				if (glyph->visible) {
-					glm::vec4 corners = glm::vec4(pos.x, pos.y, pos.x, pos.y) + glyph->corners * scaled_font_size;
-					glm::vec4 uvs = glyph->texture_coordinates;
+					float x = pos.x;
+					const auto* draw_glyph = snapshot_font->get_subpixel_glyph(glyph, x);
+
+					// Glyphs on another atlas page need their own draw command
+					if (ID3D11ShaderResourceView* page_texture = atlas_snapshot->get_page(draw_glyph->page);
+						page_texture != header_.texture) {
+						vertex_current_ptr = vtx_write;
+						index_current_ptr = idx_write;
+						vertex_current_index = vtx_idx;
+						switch_text_texture(page_texture, idx_expected_size, std::distance(iter, text.end()) + 1);
+						vtx_write = vertex_current_ptr;
+						idx_write = index_current_ptr;
+					}
+
+					glm::vec4 corners = glm::vec4(x, pos.y, x, pos.y) + draw_glyph->corners * scaled_font_size;
+					glm::vec4 uvs = draw_glyph->texture_coordinates;
 
 					idx_write[0] = vtx_idx;
 					idx_write[1] = vtx_idx + 1;
@@ -337,6 +517,12 @@ namespace renderer {
 			vertex_current_ptr = vtx_write;
 			index_current_ptr = idx_write;
 			vertex_current_index = vtx_idx;
+
+			if (ID3D11ShaderResourceView* stack_texture = texture_stack_.empty() ? nullptr : texture_stack_.back();
+				header_.texture != stack_texture) {
+				header_.texture = stack_texture;
+				update_texture();
+			}
 		}
 
 		// Stateful path API, add points then finish with path_fill() or path_stroke()
@@ -417,6 +603,12 @@ namespace renderer {
 			prim_write_vtx(pos, uv, col);
 		}
 
+		// Line list segment, the caller reserves 2 indices and 2 vertices
+		void prim_line(const glm::vec3& p1, const glm::vec3& p2, const color_rgba& col) {
+			prim_vtx(p1, tex_uv_white_pixel_, col);
+			prim_vtx(p2, tex_uv_white_pixel_, col);
+		}
+
 		const render_vector<vertex>& get_vertices();
 		const render_vector<uint32_t>& get_indices();
 		const render_vector<draw_command>& get_draw_cmds();
@@ -427,9 +619,6 @@ namespace renderer {
 	private:
 		d3d11_renderer* dx11_;
 
-		// Ugly solution for line list when rendering in world lines
-		D3D11_PRIMITIVE_TOPOLOGY topology_ = D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
-
 		render_vector<vertex> vertices_;
 		render_vector<uint32_t> indices_;
 		render_vector<draw_command> draw_cmds_;
@@ -438,20 +627,81 @@ namespace renderer {
 		int32_t vertex_current_index = 0;
 		vertex* vertex_current_ptr = nullptr;
 		uint32_t* index_current_ptr = nullptr;
+		uint64_t write_count_ = 0;
 
 		render_vector<glm::vec2> path_;
+		std::vector<glm::vec2> decimated_;
 
 		draw_command_header header_;
 		render_vector<glm::vec4> scissor_stack_;
 		render_vector<ID3D11ShaderResourceView*> texture_stack_;
+		// Composed transforms, empty means identity
+		render_vector<glm::mat3x2> transform_stack_;
+		bool transform_identity_ = true;
+		size_t transform_vtx_start_ = 0;
 
 		command_buffer active_command_{};
+
+		std::vector<std::pair<const font_atlas*, std::shared_ptr<const font_atlas::snapshot>>> atlas_snapshots_{};
+		const font_atlas::snapshot* atlas_snapshot_ = nullptr;
+		glm::vec2 tex_uv_white_pixel_{};
 		glm::mat4x4 active_projection_ = glm::mat4(1.f);
+		frustum frustum_;
+		bool frustum_dirty_ = true;
+
+		// Scratch space for culling batches
+		std::vector<glm::vec4> cull_bounds_;
+		std::vector<uint32_t> cull_visible_;
+		std::vector<uint32_t> cull_lod_visible_;
+		std::vector<uint8_t> cull_lods_;
+
+		std::vector<std::unique_ptr<buffer>> forks_;
+		size_t fork_count_ = 0;
+
+		void begin_fork(const buffer& parent);
+		void splice(buffer& child);
+
+		// Scissor and texture stacks a chunk of shapes starts with
+		struct shape_state {
+			render_vector<glm::vec4> scissors;
+			render_vector<ID3D11ShaderResourceView*> textures;
+			render_vector<glm::mat3x2> transforms;
+		};
+
+		static constexpr size_t shape_chunk_size = 256;
+
+		bool deferred_ = false;
+		render_vector<shape_command> shapes_;
+		render_vector<ID3D11ShaderResourceView*> shape_textures_;
+		shape_state shapes_base_;
+		std::vector<shape_state> shape_chunk_states_;
+
+		void record_shape(const shape_command& shape);
+		void replay_shape(const shape_command& shape, const buffer& source);
 
 		void update_scissor();
 		void update_texture();
+		void update_topology();
+		void switch_text_texture(ID3D11ShaderResourceView* srv, size_t& idx_expected_size, size_t glyphs_left);
 		void update_vtx_offset();
 
+		// Around 3D primitives, transforms the 2D vertices before them and keeps flush_transform() off the ones between
+		void begin_untransformed() {
+			flush_transform();
+		}
+
+		void end_untransformed() {
+			transform_vtx_start_ = vertices_.Size;
+		}
+
+		// Leaves the indices of the instances worth drawing in cull_visible_, with their detail level in cull_lods_
+		void cull_wireframes(float mesh_radius,
+							 std::span<const wireframe_instance> instances,
+							 std::span<const float> lod_radius = {});
+		void emit_wireframes(const wireframe_mesh& mesh,
+							 std::span<const wireframe_instance> instances,
+							 std::span<const uint32_t> visible);
+
 		[[nodiscard]] int calc_circle_auto_segment_count(float radius) const;
 		void path_arc_to_n(const glm::vec2& center, float radius, float a_min, float a_max, int num_segments);
 		void path_arc_to_fast_ex(const glm::vec2& center, float radius, int a_min_sample, int a_max_sample, int a_step);
@@ -8,8 +8,11 @@
 using Microsoft::WRL::ComPtr;
 
 #include <array>
+#include <atomic>
 #include <map>
 #include <memory>
+#include <span>
+#include <string>
 #include <unordered_map>
 
 #ifndef NOMINMAX
@@ -17,6 +20,8 @@ using Microsoft::WRL::ComPtr;
 #endif
 
 #include "context.hpp"
+#include "util/mapped_file.hpp"
+#include "util/rect_packer.hpp"
 #include "util/stb_rect_pack.hpp"
 
 #include <glm/vec2.hpp>
@@ -131,6 +136,44 @@ namespace renderer {
 		oblique = 1 << 6,
 	};
 
+	// Font file contents shared by every config registered from them, either owned or mapped straight from disk so
+	// registering a face at several sizes only keeps it in memory once. The identity stands in for the contents in the
+	// atlas cache key so a warm start never reads the font
+	class font_blob {
+	public:
+		// Owned data is hashed once for its identity unless the caller passes one that changes whenever the data does
+		explicit font_blob(std::vector<char> data);
+		font_blob(std::vector<char> data, uint64_t identity);
+		// Mapped files are identified by path, size and last write time
+		font_blob(mapped_file file, std::string_view filename);
+
+		font_blob(const font_blob&) = delete;
+		font_blob& operator=(const font_blob&) = delete;
+
+		[[nodiscard]] const uint8_t* data() const {
+			return data_;
+		}
+
+		[[nodiscard]] size_t size() const {
+			return size_;
+		}
+
+		[[nodiscard]] bool empty() const {
+			return size_ == 0;
+		}
+
+		[[nodiscard]] uint64_t get_identity() const {
+			return identity_;
+		}
+
+	private:
+		std::vector<char> owned_{};
+		mapped_file mapped_{};
+		const uint8_t* data_ = nullptr;
+		size_t size_ = 0;
+		uint64_t identity_ = 0;
+	};
+
 	class font_atlas;
 	class text_font {
 	public:
@@ -146,6 +189,11 @@ namespace renderer {
 			float advance_x = 0.f;
 			glm::vec4 corners{}, texture_coordinates{};// TODO: Ditch vec4 for these members
 			glm::vec2 offset{};
+			uint32_t page = 0;
+			// Horizontally shifted variants for phases 1..n-1 are stored at glyphs[subpixel_offset + phase - 1], a
+			// variant itself has 0 phases so it never ends up in the lookup table
+			uint32_t subpixel_phases = 1;
+			uint32_t subpixel_offset = 0;
 
 			static const uint32_t* ranges_default() {
 				static const uint32_t ranges[] = {
@@ -194,30 +242,61 @@ namespace renderer {
 			text_font* font = nullptr;
 			glyph::config glyph_config{};
 
-			std::vector<char> data{};
+			std::shared_ptr<const font_blob> data{};
 			int index = 0;
 			float size_pixels = 0.0f;
 			glm::vec2 oversample{ 3.0f, 1.0f };
+			// Horizontally shifted variants rendered per glyph (1-4) so text can be placed at fractional x. Above 1 the
+			// glyphs also advance by their unhinted widths, pixel_snap_h forces it back to 1
+			uint32_t subpixel_phases = 1;
 			bool pixel_snap_h = false;
 
 			rasterizer_flags rasterizer_flags = no_auto_hint;
 		};
 
+		// Two level table split into 256 codepoint pages, only pages that contain glyphs are allocated. Page 0 is kept
+		// empty and shared by every block without glyphs so a lookup never has to check whether its page exists
 		struct font_lookup_table {
+			static constexpr uint32_t page_bits = 8;
+			static constexpr uint32_t page_size = 1 << page_bits;
+			static constexpr uint32_t page_mask = page_size - 1;
+			static constexpr uint32_t empty_index = std::numeric_limits<uint32_t>::max();
+
+			std::vector<uint16_t> pages{};
 			std::vector<float> advances_x{};
 			std::vector<uint32_t> indexes{};
 			bool dirty = false;
 
-			void resize(size_t new_size) {
-				// Should be identical, throw error/assert
-				if (advances_x.size() != indexes.size())
-					return;
+			font_lookup_table() {
+				clear();
+			}
+
+			void clear(uint32_t max_codepoint = 0) {
+				pages.assign((max_codepoint >> page_bits) + 1, 0);
+				advances_x.assign(page_size, -1.0f);
+				indexes.assign(page_size, empty_index);
+			}
 
-				if (new_size <= indexes.size())
-					return;
+			// Codepoints past the last page land in the empty page
+			[[nodiscard]] uint32_t get_slot(uint32_t c) const {
+				const uint32_t block = c >> page_bits;
+				return (block < pages.size() ? (uint32_t)pages[block] << page_bits : 0) | (c & page_mask);
+			}
+
+			void set(uint32_t c, float advance_x, uint32_t index) {
+				const uint32_t block = c >> page_bits;
+				if (block >= pages.size())
+					pages.resize(block + 1, 0);
+
+				if (!pages[block]) {
+					pages[block] = (uint16_t)(advances_x.size() >> page_bits);
+					advances_x.resize(advances_x.size() + page_size, -1.0f);
+					indexes.resize(indexes.size() + page_size, empty_index);
+				}
 
-				advances_x.resize(new_size, -1.0f);
-				indexes.resize(new_size, std::numeric_limits<uint32_t>::max());
+				const uint32_t slot = ((uint32_t)pages[block] << page_bits) | (c & page_mask);
+				advances_x[slot] = advance_x;
+				indexes[slot] = index;
 			}
 		};
 
@@ -225,7 +304,10 @@ namespace renderer {
 		uint32_t fallback_char = '?';
 
 		font_lookup_table lookup_table{};
+		// Glyphs past merged_glyphs_offset are copies taken from the fallback fonts when the lookup table is built
 		std::vector<glyph> glyphs{};
+		size_t merged_glyphs_offset = 0;
+		std::vector<text_font*> fallback_fonts{};
 		glyph* fallback_glyph = nullptr;
 		float fallback_advance_x = 0.0f;
 
@@ -238,34 +320,61 @@ namespace renderer {
 		void build_lookup_table();
 
 		glyph* find_glyph(uint32_t c, bool fallback = true);
-		void add_glyph(
-		font_config* src_config, uint32_t c, glm::vec4 corners, const glm::vec4& texture_coordinates, float advance_x);
-
-		void set_fallback_char(const uint16_t c) {
-			fallback_char = c;
-			build_lookup_table();
-		}
+		[[nodiscard]] const glyph* find_glyph(uint32_t c, bool fallback = true) const;
+
+		// Picks the variant rasterized closest to the fractional part of x and moves x to the pixel it's drawn from
+		[[nodiscard]] const glyph* get_subpixel_glyph(const glyph* glyph, float& x) const {
+			const float x_floor = std::floor(x);
+			const float fraction = x - x_floor;
+			x = x_floor;
+			if (glyph->subpixel_phases <= 1)
+				return glyph;
+
+			const auto phase = (uint32_t)(fraction * (float)glyph->subpixel_phases + 0.5f);
+			if (phase == 0)
+				return glyph;
+
+			if (phase >= glyph->subpixel_phases) {
+				x += 1.0f;
+				return glyph;
+			}
 
-		void set_glyph_visible(const uint32_t c, const bool visible) {
-			if (glyph* glyph = find_glyph(c))
-				glyph->visible = visible;
+			return &glyphs[glyph->subpixel_offset + phase - 1];
 		}
+		void add_glyph(font_config* src_config,
+					   uint32_t c,
+					   glm::vec4 corners,
+					   const glm::vec4& texture_coordinates,
+					   float advance_x,
+					   uint32_t page = 0,
+					   uint32_t subpixel_phases = 1);
+
+		// Code points this font doesn't have are taken from the fallbacks in the order they were added, the fonts have to
+		// be in the same atlas
+		bool add_fallback_font(text_font* font);
+
+		// Draw threads read fonts from the atlas snapshot, so once the atlas is uploaded these republish it. Like builds
+		// they have to be called from the thread that owns the atlas
+		void set_fallback_char(uint16_t c);
+		void set_glyph_visible(uint32_t c, bool visible);
+		// Toggles all of them with a single republish
+		void set_glyph_visible(std::span<const uint32_t> codepoints, bool visible);
 
 		[[nodiscard]] bool is_loaded() const {
 			return container_atlas;
 		}
 
 		[[nodiscard]] float get_char_advance(uint32_t c) const {
-			return (c < lookup_table.advances_x.size()) ? lookup_table.advances_x[c] : fallback_advance_x;
+			return lookup_table.advances_x[lookup_table.get_slot(c)];
 		}
 
 		template<typename string_t>
-		glm::vec2 calc_text_size(const string_t& text, float custom_size = 0.f) {
+		glm::vec2 calc_text_size(const string_t& text, float custom_size = 0.f) const {
 			return calc_text_size(std::basic_string_view(text), custom_size);
 		}
 
 		template<typename char_t>
-		glm::vec2 calc_text_size(std::basic_string_view<char_t> text, float custom_size) {
+		glm::vec2 calc_text_size(std::basic_string_view<char_t> text, float custom_size) const {
 			glm::vec2 result{}, line_size(0.f, custom_size <= 0.f ? size : custom_size);
 
 			const float size_reciprocal = 1.f / (custom_size <= 0.f ? size : custom_size);
@@ -314,37 +423,98 @@ namespace renderer {
 			}
 		};
 
-		struct font_texture {
+		struct font_page {
 			ID3D11ShaderResourceView* data = nullptr;
-			int desired_width = 0, glyph_padding = 1;
 
 			std::vector<uint8_t> pixels_alpha8{};
 			std::vector<uint32_t> pixels_rgba32{};
 
 			glm::vec2 size{};
 
+			void get_data_as_rgba32();
+		};
+
+		struct font_texture {
+			int desired_width = 0, glyph_padding = 1;
+			// Glyphs that don't fit on a page spill over onto a new one
+			int max_page_size = 4096;
+			// Crops each page to the packed height instead of rounding it up to a power of two
+			bool tight_pages = false;
+			rect_packer_type packer = skyline_bottom_left;
+			// Uploads the atlas expanded to RGBA32 instead of sampling the single channel as coverage
+			bool use_rgba32 = false;
+
+			std::vector<font_page> pages{};
+
 			void clear() {
-				pixels_alpha8.clear();
-				pixels_rgba32.clear();
+				pages.clear();
 			}
 
 			[[nodiscard]] bool is_built() const {
-				return !pixels_alpha8.empty() || !pixels_rgba32.empty();
+				return !pages.empty();
 			}
 
-			void get_data_as_rgba32();
+			[[nodiscard]] ID3D11ShaderResourceView* get_data(size_t page = 0) const {
+				return page < pages.size() ? pages[page].data : nullptr;
+			}
+		};
+
+		// Filled in by a cold build, a cache hit leaves it empty
+		struct atlas_stats {
+			size_t pages = 0;
+			size_t glyphs_packed = 0, glyphs_dropped = 0;
+			uint64_t used_area = 0, total_area = 0;
+			float pack_time_ms = 0.0f;
+
+			[[nodiscard]] uint64_t get_wasted_area() const {
+				return total_area - used_area;
+			}
+
+			[[nodiscard]] float get_occupancy() const {
+				return total_area ? (float)used_area / (float)total_area * 100.0f : 0.0f;
+			}
 		};
 
 		font_texture texture{};
+		atlas_stats stats{};
 		render_vector<custom_rect> custom_rects{};
 		size_t white_pixel_id = 0;
 		glm::vec2 tex_uv_white_pixel{};
 		size_t lines_id = 0;
 		glm::vec4 tex_uv_lines[64]{};
 
+		// Immutable copy of everything draw threads read from the atlas. Rebuilds publish a new version and older ones
+		// stay alive, textures included, until the last buffer holding them is cleared
+		struct snapshot {
+			uint64_t version = 0;
+			std::vector<ComPtr<ID3D11ShaderResourceView>> pages{};
+			glm::vec2 tex_uv_white_pixel{};
+			std::array<glm::vec4, 64> tex_uv_lines{};
+
+			// Copies of the atlas fonts, sources holds the live font each one was taken from. Republishing after an edit
+			// only copies the edited font, every other copy is shared with the previous version
+			std::vector<const text_font*> sources{};
+			std::vector<std::shared_ptr<const text_font>> fonts{};
+
+			[[nodiscard]] ID3D11ShaderResourceView* get_page(size_t page = 0) const {
+				return page < pages.size() ? pages[page].Get() : nullptr;
+			}
+
+			// Accepts live fonts as well as fonts already taken from this snapshot
+			[[nodiscard]] const text_font* get_font(const text_font* font) const;
+		};
+
 		bool locked = false;
 		std::vector<std::unique_ptr<text_font>> fonts{};
 		std::vector<text_font::font_config> configs{};
+		// Mapped files by filename so a face registered at several sizes shares one mapping for as long as any config
+		// still uses it
+		std::unordered_map<std::string, std::weak_ptr<const font_blob>> file_blobs{};
+
+		// When set build() first tries to load the atlas from this file and writes it back after a cold build, the
+		// cache is keyed by the font blob identities and configs so any change to them invalidates it
+		std::string cache_filename{};
+		static constexpr uint32_t cache_version = 5;
 
 		~font_atlas() {
 			clear();
@@ -356,20 +526,43 @@ namespace renderer {
 		void build_finish();
 		void build();
 
-		void pack_custom_rects(stbrp_context* context);
+		void pack_custom_rects(rect_packer* packer, font_page& page);
+
+		// Called on the render thread once the page textures exist, draw threads pick the new version up the next time
+		// they acquire
+		void publish_snapshot();
+		// Publishes again after font was edited, skipped before the first upload and while a rebuild still waits for
+		// its textures since that upload publishes anyway
+		void republish_snapshot(const text_font* font);
+		void reset_snapshot() {
+			current_snapshot_.store(nullptr, std::memory_order_release);
+		}
+
+		[[nodiscard]] std::shared_ptr<const snapshot> acquire_snapshot() const {
+			return current_snapshot_.load(std::memory_order_acquire);
+		}
+
+		[[nodiscard]] uint64_t get_cache_key() const;
+		bool load_cache(std::string_view filename);
+		bool save_cache(std::string_view filename) const;
 
 		text_font* add_font(const text_font::font_config* config);
 		text_font* add_font_default(text_font::font_config* config = nullptr);
+		[[nodiscard]] std::shared_ptr<const font_blob> get_file_blob(std::string_view filename);
 		text_font* add_font_from_file_ttf(std::string_view filename,
 										  float size_pixels,
 										  text_font::font_config* config = nullptr,
 										  const uint32_t* glyph_ranges = text_font::glyph::ranges_default());
-		text_font* add_font_from_memory_ttf(const std::vector<char>& font_data,
+		text_font* add_font_from_memory_ttf(std::vector<char> font_data,
 											float size_pixels,
 											text_font::font_config* config = nullptr,
 											const uint32_t* glyph_ranges = text_font::glyph::ranges_default());
+		text_font* add_font_from_blob(std::shared_ptr<const font_blob> blob,
+									  float size_pixels,
+									  text_font::font_config* config = nullptr,
+									  const uint32_t* glyph_ranges = text_font::glyph::ranges_default());
 		text_font*
-		add_font_from_memory_compressed_ttf(const std::vector<uint8_t>& compressed_ttf,
+		add_font_from_memory_compressed_ttf(std::span<const uint8_t> compressed_ttf,
 											float size_pixels,
 											text_font::font_config* config = nullptr,
 											const uint32_t* glyph_ranges = text_font::glyph::ranges_default());
@@ -380,6 +573,13 @@ namespace renderer {
 			texture.clear();
 			fonts.clear();
 		}
+
+	private:
+		std::atomic<std::shared_ptr<const snapshot>> current_snapshot_{};
+		uint64_t snapshot_version_ = 0;
+
+		// Copies every font when previous is null, otherwise reuses its copies of all fonts but edited
+		void publish_snapshot(const snapshot* previous, const text_font* edited);
 	} inline atlas{};
 
 	struct atlases_handler {
@@ -400,9 +600,11 @@ namespace renderer {
 		std::vector<uint32_t> glyphs_set{};
 	};
 
+	// Only metrics are kept, the bitmap is rendered straight into the atlas once the glyph is packed
 	struct src_glyph {
 		text_font::glyph glyph{};
-		std::vector<uint8_t> bitmap{};
+		uint32_t glyph_index = 0;
+		uint32_t phase = 0;
 	};
 
 	struct build_src : build_data {
@@ -425,6 +627,7 @@ namespace renderer {
 
 		const std::uint32_t* src_ranges{};
 		int dst_index{};
+		uint32_t subpixel_phases = 1;
 		std::vector<src_glyph> glyphs_list{};
 	};
 }// namespace renderer
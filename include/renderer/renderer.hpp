@@ -4,7 +4,10 @@
 #include "color.hpp"
 #include "font.hpp"
 #include "texture.hpp"
+#include "util/staging.hpp"
 
+#include <array>
+#include <atomic>
 #include <glm/glm.hpp>
 #include <shared_mutex>
 #include <stack>
@@ -13,13 +16,122 @@ namespace renderer {
 	class buffer;
 	struct shared_data;
 
+	enum buffer_mode : uint8_t {
+		// Producers never wait, a frame the render thread didn't pick up in time is replaced by the next one
+		mailbox,
+		// Producers wait in swap_buffers until the render thread took their previous frame, nothing is dropped
+		fifo
+	};
+
+	struct buffer_stats {
+		uint64_t frames_published = 0;
+		uint64_t frames_presented = 0;
+		uint64_t frames_dropped = 0;
+	};
+
+	// Triple buffered slot, the producer owns working and the render thread owns active. The third buffer is handed
+	// between them through ready so the render thread always takes the newest finished frame without blocking anyone
 	struct buffer_node {
-		std::unique_ptr<buffer> active;
-		std::unique_ptr<buffer> working;
+		using child_list = std::vector<std::pair<size_t, size_t>>;
+
+		static constexpr uint8_t index_mask = 0b011;
+		static constexpr uint8_t fresh_bit = 0b100;
 
-		std::vector<std::pair<size_t, size_t>> child_buffers;
+		std::array<std::unique_ptr<buffer>, 3> buffers;
+		uint8_t working = 0;
+		uint8_t active = 1;
+		std::atomic<uint8_t> ready = 2;
+
+		// Only touched with the slot layout locked, everything else walks the flattened draw order
+		child_list children;
 		bool free = false;
 		size_t parent = std::numeric_limits<size_t>::max();
+		// Bumped whenever the slot is reused so ids of removed slots can be told apart
+		uint32_t id_generation = 0;
+
+		// Bumped by the producer on every publish, the render thread reads the active buffer's one after acquiring
+		std::array<uint64_t, 3> generations{};
+		uint64_t generation = 0;
+
+		// Render thread side, where the active buffer's geometry currently lives in the GPU buffers. Slots keep their
+		// region until their content changes so static geometry is only copied once
+		struct upload_state {
+			uint64_t generation = 0;
+			size_t vertices_offset = 0;
+			size_t indices_offset = 0;
+			bool placed = false;
+		} upload;
+
+		// A swap with nothing drawn since the last one keeps the published frame instead of publishing an empty one
+		std::atomic<bool> retain_unchanged = false;
+
+		std::atomic<buffer_mode> mode = mailbox;
+		std::atomic<uint64_t> frames_published = 0;
+		std::atomic<uint64_t> frames_presented = 0;
+		std::atomic<uint64_t> frames_dropped = 0;
+
+		[[nodiscard]] buffer* get_working() const {
+			return buffers[working].get();
+		}
+
+		[[nodiscard]] buffer* get_active() const {
+			return buffers[active].get();
+		}
+
+		// Producer side, hands the finished working buffer over and takes whichever buffer is free
+		void publish() {
+			for (uint8_t state = ready.load(std::memory_order_acquire);
+				 (state & fresh_bit) && mode.load(std::memory_order_relaxed) == fifo;
+				 state = ready.load(std::memory_order_acquire))
+				ready.wait(state, std::memory_order_acquire);
+
+			generations[working] = ++generation;
+			const uint8_t previous = ready.exchange(working | fresh_bit, std::memory_order_acq_rel);
+			working = previous & index_mask;
+
+			frames_published.fetch_add(1, std::memory_order_relaxed);
+			if (previous & fresh_bit)
+				frames_dropped.fetch_add(1, std::memory_order_relaxed);
+		}
+
+		// Render thread side, picks up the latest published buffer if there is one
+		bool acquire() {
+			if (!(ready.load(std::memory_order_relaxed) & fresh_bit))
+				return false;
+
+			active = ready.exchange(active, std::memory_order_acq_rel) & index_mask;
+			ready.notify_one();
+
+			frames_presented.fetch_add(1, std::memory_order_relaxed);
+			return true;
+		}
+
+		[[nodiscard]] uint64_t get_active_generation() const {
+			return generations[active];
+		}
+
+		[[nodiscard]] buffer_stats get_stats() const {
+			return { frames_published.load(std::memory_order_relaxed),
+					 frames_presented.load(std::memory_order_relaxed),
+					 frames_dropped.load(std::memory_order_relaxed) };
+		}
+	};
+
+	// Slots flattened in draw order, a slot is directly followed by its children so each subtree is one contiguous range.
+	// Rebuilt only when slots are registered, removed or change priority
+	struct draw_order {
+		static constexpr size_t npos = std::numeric_limits<size_t>::max();
+
+		struct entry {
+			buffer_node* node;
+			size_t id;
+			// One past the slot's last descendant
+			size_t subtree_end;
+		};
+
+		std::vector<entry> entries;
+		// Position in entries by slot index, npos for free slots
+		std::vector<size_t> positions;
 	};
 
 	// TODO: Most of the abstraction has been removed since I just want a functional D3D11 renderer currently and I
@@ -41,8 +153,10 @@ namespace renderer {
 	private:
 		void clear();
 
-		void resize_buffers();
-		void draw_batches();
+		void resize_buffers(const draw_order& order);
+		void draw_batches(const draw_order& order);
+
+		static bool is_mask_texture(ID3D11ShaderResourceView* texture);
 
 		void create_device_dependent_resources();
 		void create_window_size_dependent_resources();
@@ -53,7 +167,7 @@ namespace renderer {
 	public:
 		void render();
 
-		size_t register_buffer(size_t priority = 0, size_t vertices_reserve_size = 0, size_t indices_reserve_size = 0, size_t batches_reserve_size = 0);
+		size_t register_buffer(size_t priority = 0, size_t vertices_reserve_size = 0, size_t indices_reserve_size = 0, size_t batches_reserve_size = 0, buffer_mode mode = mailbox);
 		size_t register_child_buffer(size_t parent, size_t priority = 0, size_t vertices_reserve_size = 0, size_t indices_reserve_size = 0, size_t batches_reserve_size = 0);
 
 		void update_buffer_priority(size_t id, size_t priority = 0);
@@ -65,6 +179,19 @@ namespace renderer {
 
 		void swap_buffers(size_t id);
 
+		// fifo slots block their producer while the render thread isn't taking frames, switch them back to mailbox
+		// before shutting the render loop down
+		void set_buffer_mode(size_t id, buffer_mode mode);
+		[[nodiscard]] buffer_stats get_buffer_stats(size_t id) const;
+
+		// Records the slot's shapes as commands and tessellates them on the render thread, see buffer::set_deferred.
+		// Only the producer reads the flag so call it from there
+		void set_buffer_deferred(size_t id, bool enabled);
+
+		// Swaps that drew nothing leave the slot's last frame in place, so a producer can swap every tick and only
+		// redraw when something changed without the frame being published or uploaded again
+		void set_buffer_retained(size_t id, bool enabled);
+
 		void create_atlases();
 		void destroy_atlases();
 
@@ -78,13 +205,43 @@ namespace renderer {
         [[nodiscard]] glm::mat4x4 get_ortho_projection() const;
 
 	private:
+		// Only guards the slot layout (registration, removal and priorities), drawing and swapping never take it
 		std::shared_mutex buffer_list_mutex_;
 
-        // TODO: Store buffers in a map so if we remove a buffer we can just complelety erase it instead of just freeing
-        //  it for later
-		std::vector<buffer_node> buffers_;
+		// Slots live in fixed chunks that are never moved so producers can look theirs up without a lock
+		static constexpr size_t node_chunk_bits = 6;
+		static constexpr size_t node_chunk_size = 1 << node_chunk_bits;
+		static constexpr size_t node_chunk_mask = node_chunk_size - 1;
+		static constexpr size_t max_node_chunks = 64;
+
+		// Ids are the slot index in the low bits and the slot's generation in the high bits
+		static constexpr size_t id_index_bits = 32;
+		static constexpr size_t id_index_mask = (size_t(1) << id_index_bits) - 1;
+
+		std::array<std::unique_ptr<buffer_node[]>, max_node_chunks> node_chunks_;
+		std::atomic<size_t> node_count_ = 0;
         std::vector<std::pair<size_t, size_t>> priorities_;
-        std::vector<size_t> free_buffers_;
+
+		// A removed slot is only reused once every draw order it was part of is gone, a producer swapping a parent
+		// may still be walking one
+		struct free_node {
+			size_t index;
+			std::vector<std::weak_ptr<const draw_order>> orders;
+		};
+
+		std::vector<free_node> free_buffers_;
+		std::vector<std::weak_ptr<const draw_order>> live_draw_orders_;
+		std::atomic<std::shared_ptr<const draw_order>> draw_order_;
+
+		size_t create_node(size_t vertices_reserve_size, size_t indices_reserve_size, size_t batches_reserve_size);
+		void publish_draw_order();
+
+		[[nodiscard]] buffer_node& get_node(size_t id) const {
+			const size_t index = id & id_index_mask;
+			return node_chunks_[index >> node_chunk_bits][index & node_chunk_mask];
+		}
+
+		[[nodiscard]] bool is_valid_id(size_t id) const;
 
 	public:
 		std::unique_ptr<renderer_context> context_;
@@ -97,6 +254,13 @@ namespace renderer {
 
 		std::unique_ptr<shared_data> shared_data_;
 
+		std::vector<staging_chunk> staging_chunks_;
+		staging_copier staging_copier_;
+		// End of the used part of the GPU buffers, changed slots are appended here with no-overwrite maps until it
+		// runs out and everything is compacted with a discard
+		staging_totals staging_end_;
+		bool staging_invalid_ = true;
+
 		ComPtr<ID3D11Texture2D> msaa_render_target_;
 		ComPtr<ID3D11RenderTargetView> msaa_render_target_view_;
 		ComPtr<ID3D11DepthStencilView> msaa_depth_stencil_view_;
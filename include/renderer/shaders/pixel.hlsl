@@ -18,6 +18,12 @@ SamplerState samplerState : SAMPLER : register(s0);
 
 // How can I stack color keys?
 float4 ps_main(VS_Output input) : SV_TARGET {
-    float4 out_col = input.color * active_texture.Sample(samplerState, input.uv);
+    float4 tex_col = active_texture.Sample(samplerState, input.uv);
+
+    // Single channel atlases only store coverage in .r
+    if (is_mask)
+        return float4(input.color.rgb, input.color.a * tex_col.r);
+
+    float4 out_col = input.color * tex_col;
     return out_col;
 }
\ No newline at end of file
@@ -0,0 +1,27 @@
+#ifndef RENDERER_UTIL_COMPRESSION_HPP
+#define RENDERER_UTIL_COMPRESSION_HPP
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace renderer {
+	// Streams from stb.h's stb_compress, the format ImGui's binary_to_compressed_c emits
+	constexpr uint32_t stb_compressed_magic = 0x57BC0000;
+	// LZ4 block preceded by "RLZ4" and the little endian decompressed size, what binary_to_compressed emits
+	constexpr uint32_t lz4_compressed_magic = 0x345A4C52;
+	constexpr size_t lz4_compressed_header_size = 8;
+
+	[[nodiscard]] size_t stb_decompress_length(std::span<const uint8_t> input);
+	size_t stb_decompress(std::span<uint8_t> output, std::span<const uint8_t> input);
+
+	// Raw LZ4 blocks, decompression returns the number of bytes written or 0 when the block is malformed
+	[[nodiscard]] std::vector<uint8_t> lz4_compress(std::span<const uint8_t> input);
+	size_t lz4_decompress(std::span<uint8_t> output, std::span<const uint8_t> input);
+
+	// Compresses to the LZ4 container, decompression detects the format from the magic
+	[[nodiscard]] std::vector<uint8_t> compress_binary(std::span<const uint8_t> input);
+	bool decompress_binary(std::span<const uint8_t> input, std::vector<char>& output);
+}// namespace renderer
+
+#endif
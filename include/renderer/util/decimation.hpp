@@ -0,0 +1,42 @@
+#ifndef RENDERER_UTIL_DECIMATION_HPP
+#define RENDERER_UTIL_DECIMATION_HPP
+
+#include <glm/vec2.hpp>
+
+#include <cstddef>
+#include <span>
+#include <vector>
+
+namespace renderer {
+	enum class decimation_mode {
+		// Min/max per column when x never decreases, rdp otherwise
+		automatic,
+		// Keeps the first, lowest, highest and last point of every tolerance wide column, x must never decrease
+		min_max,
+		// Ramer-Douglas-Peucker, no dropped point is further than tolerance from the simplified path
+		rdp
+	};
+
+	struct decimation_stats {
+		size_t input_points = 0;
+		size_t output_points = 0;
+
+		// Input points per output point
+		[[nodiscard]] float get_ratio() const {
+			return output_points ? (float)input_points / (float)output_points : 0.f;
+		}
+	};
+
+	[[nodiscard]] bool is_monotonic_x(std::span<const glm::vec2> points);
+
+	// Both replace the contents of out, the first and last point are always kept
+	void decimate_min_max(std::span<const glm::vec2> points, float column_width, std::vector<glm::vec2>& out);
+	void decimate_rdp(std::span<const glm::vec2> points, float tolerance, std::vector<glm::vec2>& out);
+
+	decimation_stats decimate_polyline(std::span<const glm::vec2> points,
+									   float tolerance,
+									   decimation_mode mode,
+									   std::vector<glm::vec2>& out);
+}// namespace renderer
+
+#endif
@@ -0,0 +1,35 @@
+#ifndef RENDERER_UTIL_FRUSTUM_HPP
+#define RENDERER_UTIL_FRUSTUM_HPP
+
+#include <glm/glm.hpp>
+
+#include <array>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace renderer {
+	// Clip planes of a view projection matrix, a default constructed frustum lets everything through
+	class frustum {
+	public:
+		frustum() = default;
+		explicit frustum(const glm::mat4x4& view_projection);
+
+		[[nodiscard]] bool test_sphere(const glm::vec3& center, float radius) const;
+		[[nodiscard]] bool test_aabb(const glm::vec3& min, const glm::vec3& max) const;
+
+		// Spheres are xyz center and w radius, appends the indices of the visible ones to visible. Four spheres are
+		// tested at once
+		void cull_spheres(std::span<const glm::vec4> spheres, std::vector<uint32_t>& visible) const;
+
+		// Rough radius in pixels on a viewport viewport_height pixels tall, infinity once the center is behind the eye
+		[[nodiscard]] float get_projected_radius(const glm::vec3& center, float radius, float viewport_height) const;
+
+	private:
+		std::array<glm::vec4, 6> planes_{};
+		glm::vec4 w_row_{};
+		float y_scale_ = 0.f;
+	};
+}// namespace renderer
+
+#endif
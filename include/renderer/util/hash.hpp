@@ -0,0 +1,40 @@
+#ifndef RENDERER_UTIL_HASH_HPP
+#define RENDERER_UTIL_HASH_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+namespace renderer {
+	constexpr uint64_t hash_seed = 0xCBF29CE484222325ull;
+
+	// Mixes 8 bytes at a time, fonts can be tens of megabytes so a byte wise hash would dominate a warm start
+	inline uint64_t hash_bytes(uint64_t hash, const void* data, size_t size) {
+		constexpr uint64_t prime = 0x9E3779B97F4A7C15ull;
+		const auto* bytes = static_cast<const uint8_t*>(data);
+
+		const auto mix = [&](uint64_t value) {
+			hash ^= value * prime;
+			hash = (hash << 31 | hash >> 33) * 0xC2B2AE3D27D4EB4Full;
+		};
+
+		for (; size >= sizeof(uint64_t); bytes += sizeof(uint64_t), size -= sizeof(uint64_t)) {
+			uint64_t value;
+			memcpy(&value, bytes, sizeof(value));
+			mix(value);
+		}
+
+		uint64_t tail = 0;
+		memcpy(&tail, bytes, size);
+		mix(tail ^ size);
+
+		return hash;
+	}
+
+	template<typename T>
+	uint64_t hash_value(uint64_t hash, const T& value) {
+		return hash_bytes(hash, &value, sizeof(T));
+	}
+}// namespace renderer
+
+#endif
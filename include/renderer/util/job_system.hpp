@@ -0,0 +1,126 @@
+#ifndef RENDERER_UTIL_JOB_SYSTEM_HPP
+#define RENDERER_UTIL_JOB_SYSTEM_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace renderer {
+	// Jobs submitted against a group can be waited on together, it has to outlive its jobs
+	class job_group {
+	public:
+		[[nodiscard]] bool done() const {
+			return pending_.load() == 0;
+		}
+
+	private:
+		friend class job_system;
+
+		std::atomic<size_t> pending_ = 0;
+	};
+
+	// Work stealing pool, every worker owns a deque it pops from the back of while idle workers steal from the front
+	// of the others. Waiting on a group runs queued jobs instead of blocking so jobs can fork and join themselves
+	class job_system {
+	public:
+		using job = std::move_only_function<void()>;
+
+		static constexpr size_t any_worker = std::numeric_limits<size_t>::max();
+
+		explicit job_system(size_t worker_count = std::max(std::thread::hardware_concurrency(), 2u) - 1);
+		~job_system();
+
+		job_system(const job_system&) = delete;
+		job_system& operator=(const job_system&) = delete;
+
+		// Shared pool the renderer uses internally, apps can submit to it as well
+		static job_system& get_default();
+
+		// Jobs with an affinity only ever run on that worker and are never stolen
+		void submit(job_group& group, job&& fn, size_t worker = any_worker);
+		void wait(job_group& group);
+
+		// Runs both and returns once both are done, right is offered to other workers while this thread runs left
+		template<typename left_t, typename right_t>
+		void invoke(left_t&& left, right_t&& right) {
+			job_group group;
+			submit(group, [&right] { right(); });
+			left();
+			wait(group);
+		}
+
+		// Calls fn(first, last) over [begin, end) in chunks of at most grain, ranges are split in halves so idle
+		// workers steal big pieces and split them further themselves
+		template<typename fn_t>
+		void parallel_for(size_t begin, size_t end, size_t grain, fn_t&& fn) {
+			if (begin >= end)
+				return;
+
+			job_group group;
+			split_range(group, begin, end, std::max<size_t>(grain, 1), fn);
+			wait(group);
+		}
+
+		[[nodiscard]] size_t get_worker_count() const {
+			return workers_.size();
+		}
+
+		// Index of the calling worker in this pool or any_worker when called from another thread
+		[[nodiscard]] size_t get_worker_index() const;
+
+	private:
+		struct task {
+			job fn;
+			job_group* group;
+		};
+
+		struct worker {
+			std::mutex mutex;
+			std::deque<task> tasks;
+			std::deque<task> pinned;
+			std::atomic<size_t> pinned_count = 0;
+			std::thread thread;
+		};
+
+		std::vector<std::unique_ptr<worker>> workers_;
+
+		// Jobs submitted from threads outside the pool
+		std::mutex injected_mutex_;
+		std::deque<task> injected_;
+
+		// Stealable jobs in any queue, sleeping counts workers and waiters so wakes can skip the lock when nobody sleeps
+		std::atomic<size_t> queued_ = 0;
+		std::atomic<size_t> sleeping_ = 0;
+		std::mutex sleep_mutex_;
+		std::condition_variable sleep_condition_;
+		bool stopping_ = false;
+
+		template<typename fn_t>
+		void split_range(job_group& group, size_t begin, size_t end, size_t grain, fn_t& fn) {
+			while (end - begin > grain) {
+				const size_t middle = begin + (end - begin) / 2;
+				submit(group, [this, &group, middle, end, grain, &fn] { split_range(group, middle, end, grain, fn); });
+				end = middle;
+			}
+
+			fn(begin, end);
+		}
+
+		void worker_loop(size_t index);
+		bool try_pop(size_t index, task& out);
+		bool try_steal(size_t index, task& out);
+		bool try_run_one();
+		void run(task& task);
+		void wake(bool all);
+		[[nodiscard]] bool has_work_for(size_t index) const;
+	};
+}// namespace renderer
+
+#endif
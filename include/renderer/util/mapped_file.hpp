@@ -0,0 +1,57 @@
+#ifndef RENDERER_UTIL_MAPPED_FILE_HPP
+#define RENDERER_UTIL_MAPPED_FILE_HPP
+
+#define WIN32_LEAN_AND_MEAN
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+
+#include <Windows.h>
+#include <cstdint>
+#include <string_view>
+
+namespace renderer {
+	// Read only view of a file mapped into memory, pages are only faulted in when they are touched
+	class mapped_file {
+	public:
+		mapped_file() = default;
+		explicit mapped_file(std::string_view filename);
+
+		mapped_file(const mapped_file&) = delete;
+		mapped_file& operator=(const mapped_file&) = delete;
+
+		mapped_file(mapped_file&& other) noexcept;
+		mapped_file& operator=(mapped_file&& other) noexcept;
+
+		~mapped_file();
+
+		bool open(std::string_view filename);
+		void close();
+
+		[[nodiscard]] bool is_open() const {
+			return data_ != nullptr;
+		}
+
+		[[nodiscard]] const uint8_t* data() const {
+			return data_;
+		}
+
+		[[nodiscard]] size_t size() const {
+			return size_;
+		}
+
+		// FILETIME of the last write, 0 when it couldn't be read
+		[[nodiscard]] uint64_t get_last_write_time() const {
+			return last_write_time_;
+		}
+
+	private:
+		HANDLE file_ = INVALID_HANDLE_VALUE;
+		HANDLE mapping_ = nullptr;
+		const uint8_t* data_ = nullptr;
+		size_t size_ = 0;
+		uint64_t last_write_time_ = 0;
+	};
+}// namespace renderer
+
+#endif
@@ -0,0 +1,61 @@
+#ifndef RENDERER_UTIL_RECT_PACKER_HPP
+#define RENDERER_UTIL_RECT_PACKER_HPP
+
+#include "renderer/util/stb_rect_pack.hpp"
+
+#include <memory>
+#include <vector>
+
+namespace renderer {
+	enum rect_packer_type : uint32_t {
+		skyline_bottom_left,
+		skyline_best_fit,
+		max_rects_best_short_side
+	};
+
+	// Packs rects into a single fixed size area, pack() can be called multiple times and rects that don't fit are
+	// left with was_packed = 0 like stb_rect_pack does
+	class rect_packer {
+	public:
+		virtual ~rect_packer() = default;
+
+		virtual void init(int width, int height) = 0;
+		virtual bool pack(stbrp_rect* rects, int count) = 0;
+
+		static std::unique_ptr<rect_packer> create(rect_packer_type type);
+	};
+
+	class skyline_packer : public rect_packer {
+	public:
+		explicit skyline_packer(int heuristic) : heuristic_(heuristic) {}
+
+		void init(int width, int height) override;
+		bool pack(stbrp_rect* rects, int count) override;
+
+	private:
+		int heuristic_;
+		stbrp_context context_{};
+		std::vector<stbrp_node> nodes_;
+	};
+
+	// MaxRects with the best short side fit heuristic, keeps every maximal free rect around so it wastes less space
+	// than a skyline at the cost of a slower pack
+	class max_rects_packer : public rect_packer {
+	public:
+		void init(int width, int height) override;
+		bool pack(stbrp_rect* rects, int count) override;
+
+	private:
+		struct free_rect {
+			int x, y, w, h;
+		};
+
+		std::vector<free_rect> free_rects_;
+		std::vector<free_rect> new_free_rects_;
+		int used_height_ = 0;
+
+		void place(const free_rect& used);
+	};
+}// namespace renderer
+
+#endif
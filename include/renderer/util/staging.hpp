@@ -0,0 +1,51 @@
+#ifndef RENDERER_UTIL_STAGING_HPP
+#define RENDERER_UTIL_STAGING_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace renderer {
+	// One buffer's geometry on its way into the mapped vertex and index buffers, sizes and offsets are in bytes
+	struct staging_chunk {
+		const void* vertices = nullptr;
+		size_t vertices_size = 0;
+		const void* indices = nullptr;
+		size_t indices_size = 0;
+
+		size_t vertices_offset = 0;
+		size_t indices_offset = 0;
+	};
+
+	struct staging_totals {
+		size_t vertices_size = 0;
+		size_t indices_size = 0;
+	};
+
+	// Places every chunk right after the previous one (an exclusive prefix sum in traversal order) starting at base,
+	// returns where the last chunk ends
+	staging_totals plan_staging(std::span<staging_chunk> chunks, staging_totals base = {});
+
+	// Copies planned chunks into any writable memory, big uploads are split into slices and copied on worker threads
+	class staging_copier {
+	public:
+		static constexpr size_t slice_size = 256 * 1024;
+		static constexpr size_t parallel_threshold = 1024 * 1024;
+
+		void copy(std::span<const staging_chunk> chunks, void* vertices_dst, void* indices_dst);
+
+	private:
+		struct slice {
+			std::byte* dst;
+			const std::byte* src;
+			size_t size;
+		};
+
+		std::vector<slice> slices_;
+
+		void add_slices(std::byte* dst, const void* src, size_t size);
+	};
+}// namespace renderer
+
+#endif
@@ -2,11 +2,83 @@
 
 #include <algorithm>
 #include <corecrt_math_defines.h>
+#include <cstddef>
+#include <emmintrin.h>
 #include <glm/gtx/quaternion.hpp>
 
+// Applies inner first, both are affine so they're extended to 3x3 with a (0, 0, 1) row
+static glm::mat3x2 compose_transform(const glm::mat3x2& outer, const glm::mat3x2& inner) {
+	return glm::mat3x2(glm::mat3(outer) * glm::mat3(inner));
+}
+
+// Stores x, y and z from the low lanes of pos with one unaligned store, the fourth lane lands on uv.x which the caller
+// writes right after
+static_assert(offsetof(renderer::vertex, uv) == offsetof(renderer::vertex, pos) + sizeof(glm::vec3));
+static void store_vertex_pos(renderer::vertex* vtx, __m128 pos) {
+	_mm_storeu_ps(&vtx->pos.x, pos);
+}
+
+// dst[n] = base + src[n], four at a time
+static void store_rebased_indices(uint32_t* dst, const uint32_t* src, size_t count, uint32_t base) {
+	const __m128i base_lanes = _mm_set1_epi32((int32_t)base);
+
+	size_t n = 0;
+	for (; n + 4 <= count; n += 4)
+		_mm_storeu_si128((__m128i*)(dst + n), _mm_add_epi32(_mm_loadu_si128((const __m128i*)(src + n)), base_lanes));
+
+	for (; n < count; n++)
+		dst[n] = base + src[n];
+}
+
+// Box around the corners of a 3D primitive, for culling
+template<size_t count>
+static std::pair<glm::vec3, glm::vec3> get_bounds(std::span<glm::vec3, count> points) {
+	glm::vec3 min = points[0], max = points[0];
+	for (const glm::vec3& point : points) {
+		min = glm::min(min, point);
+		max = glm::max(max, point);
+	}
+
+	return { min, max };
+}
+
+// Unit sphere from the poles and rings - 1 latitude rings of slices vertices, joined by rings and meridians
+static void build_wireframe_sphere(renderer::wireframe_mesh& mesh, size_t rings, size_t slices) {
+	mesh.radius = 1.f;
+	mesh.vertices.emplace_back(0.f, 1.f, 0.f);
+	mesh.vertices.emplace_back(0.f, -1.f, 0.f);
+	for (size_t ring = 1; ring < rings; ring++) {
+		const float phi = (float)ring / (float)rings * (float)M_PI;
+		for (size_t slice = 0; slice < slices; slice++) {
+			const float theta = (float)slice / (float)slices * (float)M_PI * 2.f;
+			mesh.vertices.emplace_back(sinf(phi) * cosf(theta), cosf(phi), sinf(phi) * sinf(theta));
+		}
+	}
+
+	const auto add_line = [&](size_t a, size_t b) {
+		mesh.indices.push_back((uint32_t)a);
+		mesh.indices.push_back((uint32_t)b);
+	};
+	const auto ring_vertex = [&](size_t ring, size_t slice) {
+		return 2 + (ring - 1) * slices + slice % slices;
+	};
+
+	for (size_t ring = 1; ring < rings; ring++) {
+		for (size_t slice = 0; slice < slices; slice++)
+			add_line(ring_vertex(ring, slice), ring_vertex(ring, slice + 1));
+	}
+	for (size_t slice = 0; slice < slices; slice++) {
+		add_line(0, ring_vertex(1, slice));
+		for (size_t ring = 1; ring + 1 < rings; ring++)
+			add_line(ring_vertex(ring, slice), ring_vertex(ring + 1, slice));
+		add_line(ring_vertex(rings - 1, slice), 1);
+	}
+}
+
 void renderer::buffer::clear() {
 	vertices_.resize(0);
 	indices_.resize(0);
+	write_count_ = 0;
 	draw_cmds_.resize(0);
 	temp_buffer_.resize(0);
 	draw_cmds_.push_back({});
@@ -15,28 +87,364 @@ void renderer::buffer::clear() {
 	vertex_current_ptr = vertices_.Data;
 	index_current_ptr = indices_.Data;
 
-	memset(&header_, 0, sizeof(header_));
+	header_ = {};
 
 	scissor_stack_ = {};
 	texture_stack_ = {};
+	transform_stack_ = {};
+	transform_identity_ = true;
+	transform_vtx_start_ = 0;
 
 	path_.resize(0);
 
 	active_command_ = {};
 
-	push_texture(get_default_font()->container_atlas->texture.data);
+	// Forks that were never joined are dropped with the frame
+	fork_count_ = 0;
+
+	shapes_.resize(0);
+	shape_textures_.resize(0);
+
+	// Snapshots are taken once per frame, a rebuild published in the meantime is picked up on the next clear
+	atlas_snapshots_.clear();
+	atlas_snapshot_ = get_atlas_snapshot(get_default_font()->container_atlas);
+	tex_uv_white_pixel_ = atlas_snapshot_ ? atlas_snapshot_->tex_uv_white_pixel : glm::vec2{};
+
+	push_texture(atlas_snapshot_ ? atlas_snapshot_->get_page() : nullptr);
 	push_scissor(dx11_->get_shared_data()->full_clip_rect);
 }
 
-// https://stackoverflow.com/a/28050328
-template<std::floating_point T>
-T cos_approximation(T x) noexcept {
-	constexpr T tp = 1. / (2. * M_PI);
-	x *= tp;
-	x -= T(.25) + std::floor(x + T(.25));
-	x *= T(16.) * (std::abs(x) - T(.5));
-	x += T(.225) * x * (std::abs(x) - T(1.));
-	return x;
+renderer::buffer* renderer::buffer::fork() {
+	if (fork_count_ == forks_.size())
+		forks_.push_back(std::make_unique<buffer>(dx11_));
+
+	buffer* child = forks_[fork_count_++].get();
+	child->begin_fork(*this);
+	return child;
+}
+
+void renderer::buffer::begin_fork(const buffer& parent) {
+	vertices_.resize(0);
+	indices_.resize(0);
+	write_count_ = 0;
+	draw_cmds_.resize(0);
+	temp_buffer_.resize(0);
+	path_.resize(0);
+
+	vertex_current_index = 0;
+	vertex_current_ptr = vertices_.Data;
+	index_current_ptr = indices_.Data;
+
+	active_projection_ = parent.active_projection_;
+	frustum_dirty_ = true;
+	active_command_ = parent.active_command_;
+
+	// Sharing the parent's snapshots keeps text on the same atlas version as everything around it
+	atlas_snapshots_ = parent.atlas_snapshots_;
+	atlas_snapshot_ = parent.atlas_snapshot_;
+	tex_uv_white_pixel_ = parent.tex_uv_white_pixel_;
+
+	header_ = parent.header_;
+	header_.vtx_offset = 0;
+	scissor_stack_.resize(0);
+	scissor_stack_.push_back(header_.clip_rect);
+	texture_stack_.resize(0);
+	texture_stack_.push_back(header_.texture);
+	transform_stack_ = parent.transform_stack_;
+	transform_identity_ = parent.transform_identity_;
+	transform_vtx_start_ = 0;
+
+	fork_count_ = 0;
+	deferred_ = false;
+	shapes_.resize(0);
+	shape_textures_.resize(0);
+	add_draw_cmd();
+}
+
+void renderer::buffer::join() {
+	// Forks apply their own transforms, only what this buffer drew itself is still pending
+	flush_transform();
+
+	for (size_t i = 0; i < fork_count_; i++)
+		splice(*forks_[i]);
+
+	fork_count_ = 0;
+	transform_vtx_start_ = vertices_.Size;
+
+	vertex_current_ptr = vertices_.Data + vertices_.Size;
+	index_current_ptr = indices_.Data + indices_.Size;
+
+	// Whatever is drawn after the join continues with this buffer's own state
+	draw_command& last = draw_cmds_.back();
+	if (last.elem_count == 0) {
+		last.clip_rect = header_.clip_rect;
+		last.topology = header_.topology;
+		last.texture = header_.texture;
+		last.idx_offset = indices_.Size;
+	}
+	else if (last.clip_rect != header_.clip_rect || last.topology != header_.topology ||
+			 last.texture != header_.texture) {
+		add_draw_cmd();
+	}
+}
+
+void renderer::buffer::splice(buffer& child) {
+	// Nested forks land inside their parent fork
+	child.join();
+	child.flush_transform();
+	write_count_ += child.write_count_;
+
+	const auto vtx_base = (uint32_t)vertex_current_index;
+	const auto idx_base = (uint32_t)indices_.Size;
+
+	const size_t vtx_old_size = vertices_.Size;
+	vertices_.resize(vtx_old_size + child.vertices_.Size);
+	if (child.vertices_.Size)
+		memcpy(vertices_.Data + vtx_old_size, child.vertices_.Data, child.vertices_.Size * sizeof(vertex));
+
+	// Indices are rebased in one pass instead of giving the fork its own vtx_offset, so spliced commands can merge
+	// with the ones around them
+	indices_.resize(idx_base + child.indices_.Size);
+	std::transform(child.indices_.Data,
+				   child.indices_.Data + child.indices_.Size,
+				   indices_.Data + idx_base,
+				   [vtx_base](uint32_t idx) { return idx + vtx_base; });
+
+	for (const draw_command& cmd : child.draw_cmds_) {
+		if (!cmd.elem_count)
+			continue;
+
+		draw_command& last = draw_cmds_.back();
+		const uint32_t idx_offset = cmd.idx_offset + idx_base;
+		if (last.elem_count == 0) {
+			last.clip_rect = cmd.clip_rect;
+			last.topology = cmd.topology;
+			last.texture = cmd.texture;
+			last.idx_offset = idx_offset;
+			last.elem_count = cmd.elem_count;
+		}
+		else if (last.clip_rect == cmd.clip_rect && last.topology == cmd.topology && last.texture == cmd.texture &&
+				 last.idx_offset + last.elem_count == idx_offset) {
+			last.elem_count += cmd.elem_count;
+		}
+		else {
+			draw_command spliced = last;
+			spliced.clip_rect = cmd.clip_rect;
+			spliced.topology = cmd.topology;
+			spliced.texture = cmd.texture;
+			spliced.idx_offset = idx_offset;
+			spliced.elem_count = cmd.elem_count;
+			draw_cmds_.push_back(spliced);
+		}
+	}
+
+	// Pages the fork drew with have to stay alive as long as this buffer's commands
+	for (auto& [atlas, snapshot] : child.atlas_snapshots_) {
+		if (std::ranges::none_of(atlas_snapshots_, [&](const auto& own) { return own.first == atlas; }))
+			atlas_snapshots_.emplace_back(atlas, std::move(snapshot));
+	}
+
+	vertex_current_index += (int32_t)child.vertices_.Size;
+}
+
+void renderer::buffer::set_deferred(bool deferred) {
+	deferred_ = deferred;
+}
+
+bool renderer::buffer::is_deferred() const {
+	return deferred_;
+}
+
+void renderer::buffer::record_shape(const shape_command& shape) {
+	// Scissors and textures pushed before the first shape are the state the shapes start with
+	if (shapes_.empty()) {
+		shapes_base_.scissors = scissor_stack_;
+		shapes_base_.textures = texture_stack_;
+		shapes_base_.transforms = transform_stack_;
+	}
+
+	shapes_.push_back(shape);
+	write_count_++;
+}
+
+void renderer::buffer::tessellate_shapes() {
+	if (shapes_.empty())
+		return;
+
+	// State changes are replayed once up front so every chunk knows the scissor and texture it starts with
+	const size_t chunks = (shapes_.Size + shape_chunk_size - 1) / shape_chunk_size;
+	shape_chunk_states_.resize(chunks);
+
+	shape_state state = shapes_base_;
+	for (size_t chunk = 0; chunk < chunks; chunk++) {
+		shape_chunk_states_[chunk] = state;
+
+		const size_t last = std::min((size_t)shapes_.Size, (chunk + 1) * shape_chunk_size);
+		for (size_t i = chunk * shape_chunk_size; i < last; i++) {
+			const shape_command& shape = shapes_[i];
+			switch (shape.type) {
+				case shape_type::push_scissor:
+					state.scissors.push_back(glm::vec4(shape.points[0], shape.points[1]));
+					break;
+				case shape_type::pop_scissor:
+					if (!state.scissors.empty())
+						state.scissors.pop_back();
+					break;
+				case shape_type::push_texture:
+					state.textures.push_back(shape_textures_[shape.segments]);
+					break;
+				case shape_type::pop_texture:
+					if (!state.textures.empty())
+						state.textures.pop_back();
+					break;
+				case shape_type::push_transform:
+					state.transforms.push_back(compose_transform(
+					state.transforms.empty() ? glm::mat3x2(1.f) : state.transforms.back(),
+					glm::mat3x2(shape.points[0], shape.points[1], shape.points[2])));
+					break;
+				case shape_type::pop_transform:
+					if (!state.transforms.empty())
+						state.transforms.pop_back();
+					break;
+				default:
+					break;
+			}
+		}
+	}
+
+	const size_t first_fork = fork_count_;
+	for (const shape_state& chunk_state : shape_chunk_states_) {
+		buffer* child = fork();
+		child->scissor_stack_ = chunk_state.scissors;
+		child->texture_stack_ = chunk_state.textures;
+		child->header_.clip_rect =
+		chunk_state.scissors.empty() ? dx11_->get_shared_data()->full_clip_rect : chunk_state.scissors.back();
+		child->header_.texture = chunk_state.textures.empty() ? nullptr : chunk_state.textures.back();
+		// Shapes are always triangles, whatever the buffer was set to when they were recorded
+		child->header_.topology = D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
+		child->draw_cmds_.back().clip_rect = child->header_.clip_rect;
+		child->draw_cmds_.back().topology = child->header_.topology;
+		child->draw_cmds_.back().texture = child->header_.texture;
+		child->transform_stack_ = chunk_state.transforms;
+		child->transform_identity_ =
+		chunk_state.transforms.empty() || chunk_state.transforms.back() == glm::mat3x2(1.f);
+	}
+
+	job_system::get_default().parallel_for(0, chunks, 1, [&](size_t first, size_t last) {
+		for (size_t chunk = first; chunk < last; chunk++) {
+			buffer& target = *forks_[first_fork + chunk];
+			const size_t end = std::min((size_t)shapes_.Size, (chunk + 1) * shape_chunk_size);
+			for (size_t i = chunk * shape_chunk_size; i < end; i++)
+				target.replay_shape(shapes_[i], *this);
+		}
+	});
+
+	join();
+
+	shapes_.resize(0);
+	shape_textures_.resize(0);
+}
+
+void renderer::buffer::replay_shape(const shape_command& shape, const buffer& source) {
+	const glm::vec2* points = shape.points;
+
+	switch (shape.type) {
+		case shape_type::push_scissor:
+			push_scissor(glm::vec4(points[0], points[1]));
+			return;
+		case shape_type::pop_scissor:
+			pop_scissor();
+			return;
+		case shape_type::push_texture:
+			push_texture(source.shape_textures_[shape.segments]);
+			return;
+		case shape_type::pop_texture:
+			pop_texture();
+			return;
+		case shape_type::push_transform:
+			push_transform(glm::mat3x2(points[0], points[1], points[2]));
+			return;
+		case shape_type::pop_transform:
+			pop_transform();
+			return;
+		default:
+			break;
+	}
+
+	// Culled against the scissor the shape was recorded under, padded for thickness and the anti-aliasing fringe
+	glm::vec2 min, max;
+	if (shape.type == shape_type::circle || shape.type == shape_type::circle_filled) {
+		min = points[0] - points[1];
+		max = points[0] + points[1];
+	}
+	else {
+		const bool triangle = shape.type == shape_type::triangle || shape.type == shape_type::triangle_filled;
+		min = glm::min(points[0], points[1]);
+		max = glm::max(points[0], points[1]);
+		if (triangle) {
+			min = glm::min(min, points[2]);
+			max = glm::max(max, points[2]);
+		}
+	}
+
+	if (!transform_identity_) {
+		// Bounds are local to the transform, cull the box around the transformed corners
+		const glm::mat3x2& transform = transform_stack_.back();
+		const glm::vec2 corners[4] = { transform * glm::vec3(min, 1.f),
+									   transform * glm::vec3(max.x, min.y, 1.f),
+									   transform * glm::vec3(max, 1.f),
+									   transform * glm::vec3(min.x, max.y, 1.f) };
+		min = glm::min(glm::min(corners[0], corners[1]), glm::min(corners[2], corners[3]));
+		max = glm::max(glm::max(corners[0], corners[1]), glm::max(corners[2], corners[3]));
+	}
+
+	const float padding = shape.thickness + 1.f;
+	const glm::vec4& clip = header_.clip_rect;
+	if (max.x + padding < clip.x || max.y + padding < clip.y || min.x - padding > clip.z || min.y - padding > clip.w)
+		return;
+
+	switch (shape.type) {
+		case shape_type::line:
+			draw_line(points[0], points[1], shape.col, shape.thickness);
+			break;
+		case shape_type::rect:
+			draw_rect(points[0], points[1], shape.col, shape.rounding, shape.flags, shape.thickness);
+			break;
+		case shape_type::rect_filled:
+			draw_rect_filled(points[0], points[1], shape.col, shape.rounding, shape.flags);
+			break;
+		case shape_type::triangle:
+			draw_triangle(points[0], points[1], points[2], shape.col, shape.thickness);
+			break;
+		case shape_type::triangle_filled:
+			draw_triangle_filled(points[0], points[1], points[2], shape.col, shape.flags);
+			break;
+		case shape_type::circle:
+			draw_circle(points[0], points[1].x, shape.col, shape.thickness, shape.segments);
+			break;
+		case shape_type::circle_filled:
+			draw_circle_filled(points[0], points[1].x, shape.col, shape.segments, shape.flags);
+			break;
+		default:
+			break;
+	}
+}
+
+const renderer::font_atlas::snapshot* renderer::buffer::get_atlas_snapshot(const font_atlas* atlas) {
+	if (!atlas)
+		return nullptr;
+
+	for (const auto& [snapshot_atlas, snapshot] : atlas_snapshots_) {
+		if (snapshot_atlas == atlas)
+			return snapshot.get();
+	}
+
+	return atlas_snapshots_.emplace_back(atlas, atlas->acquire_snapshot()).second.get();
+}
+
+const renderer::text_font* renderer::buffer::get_font(const text_font* font) {
+	const font_atlas::snapshot* snapshot = font ? get_atlas_snapshot(font->container_atlas) : nullptr;
+	return snapshot ? snapshot->get_font(font) : nullptr;
 }
 
 void renderer::buffer::path_arc_to_n(
@@ -294,6 +702,8 @@ void renderer::buffer::prim_reserve(const size_t idx_count, const size_t vtx_cou
 	const size_t idx_buffer_old_size = indices_.size();
 	indices_.resize(idx_buffer_old_size + idx_count);
 	index_current_ptr = indices_.Data + idx_buffer_old_size;
+
+	write_count_++;
 };
 
 void renderer::buffer::prim_unreserve(const size_t idx_count, const size_t vtx_count) {
@@ -306,7 +716,7 @@ void renderer::buffer::prim_unreserve(const size_t idx_count, const size_t vtx_c
 
 void renderer::buffer::prim_rect(const glm::vec2& a, const glm::vec2& c, const color_rgba& col) {
 	const glm::vec3 a_a(a.x, a.y, 0.f), b(c.x, a.y, 0.f), c_c(c.x, c.y, 0.f), d(a.x, c.y, 0.f);
-	const glm::vec2 uv = dx11_->get_shared_data()->tex_uv_white_pixel;
+	const glm::vec2 uv = tex_uv_white_pixel_;
 
 	const uint32_t idx = vertex_current_index;
 	index_current_ptr[0] = idx;
@@ -413,13 +823,117 @@ const renderer::command_buffer& renderer::buffer::get_active_command() {
 }
 
 void renderer::buffer::draw_point(const glm::vec2& pos, const color_rgba& col) {
-	prim_vtx({ pos.x, pos.y, 0.f }, {}, col);
+	if (col.a == 0)
+		return;
+
+	prim_reserve(6, 4);
+	prim_rect(pos, pos + 1.f, col);
+}
+
+void renderer::buffer::draw_points(std::span<const point_instance> points, marker_shape shape, float size) {
+	if (points.empty() || size <= 0.f)
+		return;
+
+	constexpr size_t max_marker_vertices = 32;
+	constexpr size_t parallel_grain = 16384;
+
+	// Marker geometry around the origin, every point copies it
+	std::array<glm::vec2, max_marker_vertices> offsets;
+	std::array<uint32_t, (max_marker_vertices - 2) * 3> pattern;
+	size_t vtx_count = 0, idx_count = 0;
+
+	const float half = size * 0.5f;
+	const auto add_quad = [&](const glm::vec2& a, const glm::vec2& b, const glm::vec2& c, const glm::vec2& d) {
+		const auto first = (uint32_t)vtx_count;
+		offsets[vtx_count++] = a;
+		offsets[vtx_count++] = b;
+		offsets[vtx_count++] = c;
+		offsets[vtx_count++] = d;
+		for (const uint32_t i : { 0u, 1u, 2u, 0u, 2u, 3u })
+			pattern[idx_count++] = first + i;
+	};
+
+	switch (shape) {
+		case marker_shape::square:
+			add_quad({ -half, -half }, { half, -half }, { half, half }, { -half, half });
+			break;
+		case marker_shape::diamond:
+			add_quad({ 0.f, -half }, { half, 0.f }, { 0.f, half }, { -half, 0.f });
+			break;
+		case marker_shape::cross: {
+			const float arm = std::max(size * 0.125f, 0.5f);
+			add_quad({ -half, -arm }, { half, -arm }, { half, arm }, { -half, arm });
+			add_quad({ -arm, -half }, { arm, -half }, { arm, half }, { -arm, half });
+			break;
+		}
+		case marker_shape::circle: {
+			const size_t segments =
+			std::clamp<size_t>(calc_circle_auto_segment_count(half), 4, max_marker_vertices);
+			for (size_t i = 0; i < segments; i++) {
+				const float a = (float)i / (float)segments * (float)M_PI * 2.f;
+				offsets[vtx_count++] = { cosf(a) * half, sinf(a) * half };
+			}
+			for (uint32_t i = 2; i < segments; i++) {
+				pattern[idx_count++] = 0;
+				pattern[idx_count++] = i - 1;
+				pattern[idx_count++] = i;
+			}
+			break;
+		}
+	}
+
+	std::array<__m128, max_marker_vertices> offset_lanes;
+	for (size_t v = 0; v < vtx_count; v++)
+		offset_lanes[v] = _mm_setr_ps(offsets[v].x, offsets[v].y, 0.f, 0.f);
+
+	prim_reserve(idx_count * points.size(), vtx_count * points.size());
+
+	vertex* const vtx_write = vertex_current_ptr;
+	uint32_t* const idx_write = index_current_ptr;
+	const uint32_t vtx_base = vertex_current_index;
+	const glm::vec2 uv = tex_uv_white_pixel_;
+
+	// Every point owns a fixed slice of the reserved geometry so chunks can be written in any order
+	const auto write = [&](size_t first, size_t last) {
+		vertex* vtx = vtx_write + first * vtx_count;
+		uint32_t* idx = idx_write + first * idx_count;
+		for (size_t i = first; i < last; i++) {
+			const point_instance& point = points[i];
+			const auto base = (uint32_t)(vtx_base + i * vtx_count);
+
+			// Loads x and y into the low lanes and zeroes the rest, so z comes out as 0
+			const __m128 center = _mm_castpd_ps(_mm_load_sd((const double*)&point.pos));
+			for (size_t v = 0; v < vtx_count; v++) {
+				store_vertex_pos(&vtx[v], _mm_add_ps(center, offset_lanes[v]));
+				vtx[v].uv = uv;
+				vtx[v].col = point.col.rgba;
+			}
+			store_rebased_indices(idx, pattern.data(), idx_count, base);
+
+			vtx += vtx_count;
+			idx += idx_count;
+		}
+	};
+
+	if (points.size() > parallel_grain)
+		job_system::get_default().parallel_for(0, points.size(), parallel_grain, write);
+	else
+		write(0, points.size());
+
+	vertex_current_ptr += vtx_count * points.size();
+	index_current_ptr += idx_count * points.size();
+	vertex_current_index += (int32_t)(vtx_count * points.size());
 }
 
 void renderer::buffer::draw_line(const glm::vec2& p1, const glm::vec2& p2, const color_rgba& col, float thickness) {
 	if (col.a == 0)
 		return;
 
+	if (deferred_) {
+		record_shape({ .type{ shape_type::line }, .col{ col }, .thickness{ thickness }, .points{ p1, p2 } });
+		return;
+	}
+
 	path_line_to(p1 + glm::vec2(0.5f, 0.5f));
 	path_line_to(p2 + glm::vec2(0.5f, 0.5f));
 	path_stroke(col, none, thickness);
@@ -430,6 +944,16 @@ const glm::vec2& p1, const glm::vec2& p2, const color_rgba& col, float rounding,
 	if (col.a == 0)
 		return;
 
+	if (deferred_) {
+		record_shape({ .type{ shape_type::rect },
+					   .flags{ flags },
+					   .col{ col },
+					   .thickness{ thickness },
+					   .rounding{ rounding },
+					   .points{ p1, p2 } });
+		return;
+	}
+
 	if (flags & anti_aliased_lines)
 		path_rect(p1 + glm::vec2(0.5f, 0.5f), p2 - glm::vec2(0.5f, 0.5f), rounding, flags);
 	else
@@ -446,6 +970,12 @@ const glm::vec2& p1, const glm::vec2& p2, const color_rgba& col, float rounding,
 	if (col.a == 0)
 		return;
 
+	if (deferred_) {
+		record_shape(
+		{ .type{ shape_type::rect_filled }, .flags{ flags }, .col{ col }, .rounding{ rounding }, .points{ p1, p2 } });
+		return;
+	}
+
 	if (rounding < 0.5f || (flags & edge_mask) == edge_none) {
 		prim_reserve(6, 4);
 		prim_rect(p1, p2, col);
@@ -465,7 +995,7 @@ void renderer::buffer::draw_rect_filled_multicolor(const glm::vec2& p1,
 	if (col_upr_left.a | col_upr_right.a | col_bot_right.a | col_bot_left.a == 0)
 		return;
 
-	const glm::vec2 uv = dx11_->get_shared_data()->tex_uv_white_pixel;
+	const glm::vec2 uv = tex_uv_white_pixel_;
 	prim_reserve(6, 4);
 	prim_write_idx(vertex_current_index);
 	prim_write_idx(vertex_current_index + 1);
@@ -517,6 +1047,11 @@ const glm::vec2& p1, const glm::vec2& p2, const glm::vec2& p3, const color_rgba&
 	if (col.a == 0)
 		return;
 
+	if (deferred_) {
+		record_shape({ .type{ shape_type::triangle }, .col{ col }, .thickness{ thickness }, .points{ p1, p2, p3 } });
+		return;
+	}
+
 	path_line_to(p1);
 	path_line_to(p2);
 	path_line_to(p3);
@@ -528,6 +1063,11 @@ const glm::vec2& p1, const glm::vec2& p2, const glm::vec2& p3, const color_rgba&
 	if (col.a == 0)
 		return;
 
+	if (deferred_) {
+		record_shape({ .type{ shape_type::triangle_filled }, .flags{ flags }, .col{ col }, .points{ p1, p2, p3 } });
+		return;
+	}
+
 	path_line_to(p1);
 	path_line_to(p2);
 	path_line_to(p3);
@@ -539,6 +1079,15 @@ const glm::vec2& center, float radius, const color_rgba& col, float thickness, s
 	if (col.a == 0 || radius < 0.5f)
 		return;
 
+	if (deferred_) {
+		record_shape({ .type{ shape_type::circle },
+					   .col{ col },
+					   .segments{ (uint32_t)segments },
+					   .thickness{ thickness },
+					   .points{ center, glm::vec2(radius) } });
+		return;
+	}
+
 	if (segments == 0) {
 		path_arc_to_fast_ex(center, radius - 0.5f, 0, dx11_->get_shared_data()->arc_fast_vtx_size, 0);
 		path_.resize(path_.size() - 1);
@@ -560,6 +1109,15 @@ const glm::vec2& center, float radius, const color_rgba& col, size_t segments, d
 	if (col.a == 0 || radius < 0.5f)
 		return;
 
+	if (deferred_) {
+		record_shape({ .type{ shape_type::circle_filled },
+					   .flags{ flags },
+					   .col{ col },
+					   .segments{ (uint32_t)segments },
+					   .points{ center, glm::vec2(radius) } });
+		return;
+	}
+
 	if (segments == 0) {
 		path_arc_to_fast_ex(center, radius - 0.5f, 0, dx11_->get_shared_data()->arc_fast_vtx_size, 0);
 		path_.resize(path_.size() - 1);
@@ -645,7 +1203,7 @@ const glm::vec2* points, int num_points, const color_rgba& col, draw_flags flags
 		return;
 
 	const bool closed = (flags & draw_flags::closed) != 0;
-	const glm::vec2 opaque_uv = dx11_->get_shared_data()->tex_uv_white_pixel;
+	const glm::vec2 opaque_uv = tex_uv_white_pixel_;
 	const int count = closed ? num_points : num_points - 1;// The number of line segments we need to draw
 	const bool thick_line = (thickness > 1.f);
 
@@ -662,7 +1220,7 @@ const glm::vec2* points, int num_points, const color_rgba& col, draw_flags flags
 		// - For now, only draw integer-width lines using textures to avoid issues with the way scaling occurs, could be
 		// improved.
 		// - If AA_SIZE is not 1.0f we cannot use the texture path.
-		const bool use_texture = (flags & anti_aliased_lines_use_tex) && (int_thickness < 63) &&
+		const bool use_texture = atlas_snapshot_ && (flags & anti_aliased_lines_use_tex) && (int_thickness < 63) &&
 								 (fractional_thickness <= 0.00001f) && (AA_SIZE == 1.0f);
 
 		const int idx_count = use_texture ? (count * 6) : (thick_line ? count * 18 : count * 12);
@@ -783,7 +1341,7 @@ const glm::vec2* points, int num_points, const color_rgba& col, draw_flags flags
 			// Add vertexes for each point on the line
 			if (use_texture) {
 				// If we're using textures we only need to emit the left/right edge vertices
-				glm::vec4 tex_uvs = dx11_->get_shared_data()->tex_uv_lines[int_thickness];
+				glm::vec4 tex_uvs = atlas_snapshot_->tex_uv_lines[int_thickness];
 				/*if (fractional_thickness != 0.0f) // Currently always zero when use_texture==false!
 				{
 					const ImVec4 tex_uvs_1 = _Data->TexUvLines[integer_thickness + 1];
@@ -978,6 +1536,22 @@ const glm::vec2* points, int num_points, const color_rgba& col, draw_flags flags
 	}
 }
 
+renderer::decimation_stats renderer::buffer::draw_polyline_decimated(const glm::vec2* points,
+																   int num_points,
+																   const color_rgba& col,
+																   draw_flags flags,
+																   float thickness,
+																   float tolerance,
+																   decimation_mode mode) {
+	if (num_points < 2)
+		return {};
+
+	const decimation_stats stats =
+	decimate_polyline(std::span(points, (size_t)num_points), tolerance, mode, decimated_);
+	draw_polyline(decimated_.data(), (int)decimated_.size(), col, flags, thickness);
+	return stats;
+}
+
 void renderer::buffer::draw_convex_poly_filled(const glm::vec2* points,
 											   int num_points,
 											   const color_rgba& col,
@@ -985,7 +1559,7 @@ void renderer::buffer::draw_convex_poly_filled(const glm::vec2* points,
 	if (num_points < 3 || col.a == 0)
 		return;
 
-	const glm::vec2 uv = dx11_->get_shared_data()->tex_uv_white_pixel;
+	const glm::vec2 uv = tex_uv_white_pixel_;
 
 	if (flags & anti_aliased_fill) {
 		// Anti-aliased Fill
@@ -1113,36 +1687,46 @@ void renderer::buffer::draw_bezier_quadratic(const glm::vec2& p1,
 }
 
 void renderer::buffer::draw_line(const glm::vec3& p1, const glm::vec3& p2, const color_rgba& col) {
+	const D3D11_PRIMITIVE_TOPOLOGY topology = header_.topology;
+	set_topology(D3D11_PRIMITIVE_TOPOLOGY_LINELIST);
+
+	begin_untransformed();
 	prim_reserve(2, 2);
+	prim_line(p1, p2, col);
+	end_untransformed();
 
-	uint32_t idx = vertex_current_index;
-	index_current_ptr[0] = idx;
-	index_current_ptr[1] = idx + 1;
-	vertex_current_ptr[0].pos = p1;
-	vertex_current_ptr[0].uv = dx11_->get_shared_data()->tex_uv_white_pixel;
-	vertex_current_ptr[0].col = col.rgba;
-	vertex_current_ptr[1].pos = p2;
-	vertex_current_ptr[1].uv = dx11_->get_shared_data()->tex_uv_white_pixel;
-	vertex_current_ptr[1].col = col.rgba;
-	vertex_current_ptr += 2;
-	vertex_current_index += 2;
-	index_current_ptr += 2;
+	set_topology(topology);
 }
 
 void renderer::buffer::draw_plane(const std::span<glm::vec3, 4> points, const color_rgba& col) {
+	if (const auto [min, max] = get_bounds(points); !get_frustum().test_aabb(min, max))
+		return;
+
 	constexpr int ftl = 0;
 	constexpr int ftr = 1;
 	constexpr int fbl = 2;
 	constexpr int fbr = 3;
 
+	const D3D11_PRIMITIVE_TOPOLOGY topology = header_.topology;
+	set_topology(D3D11_PRIMITIVE_TOPOLOGY_LINELIST);
+	begin_untransformed();
+	prim_reserve(8, 8);
+
 	// Front face
-	draw_line(points[ftl], points[ftr], col);
-	draw_line(points[ftr], points[fbr], col);
-	draw_line(points[fbr], points[fbl], col);
-	draw_line(points[fbl], points[ftl], col);
+	prim_line(points[ftl], points[ftr], col);
+	prim_line(points[ftr], points[fbr], col);
+	prim_line(points[fbr], points[fbl], col);
+	prim_line(points[fbl], points[ftl], col);
+
+	end_untransformed();
+	set_topology(topology);
 }
 
 void renderer::buffer::draw_filled_plane(const std::span<glm::vec3, 4> points, const color_rgba& col) {
+	if (const auto [min, max] = get_bounds(points); !get_frustum().test_aabb(min, max))
+		return;
+
+	begin_untransformed();
 	prim_reserve(6, 4);
 
 	constexpr int ftl = 0;
@@ -1161,24 +1745,29 @@ void renderer::buffer::draw_filled_plane(const std::span<glm::vec3, 4> points, c
 	index_current_ptr[5] = idx + fbl;
 
 	vertex_current_ptr[ftl].pos = points[ftl];
-	vertex_current_ptr[ftl].uv = dx11_->get_shared_data()->tex_uv_white_pixel;
+	vertex_current_ptr[ftl].uv = tex_uv_white_pixel_;
 	vertex_current_ptr[ftl].col = col.rgba;
 	vertex_current_ptr[ftr].pos = points[ftr];
-	vertex_current_ptr[ftr].uv = dx11_->get_shared_data()->tex_uv_white_pixel;
+	vertex_current_ptr[ftr].uv = tex_uv_white_pixel_;
 	vertex_current_ptr[ftr].col = col.rgba;
 	vertex_current_ptr[fbl].pos = points[fbl];
-	vertex_current_ptr[fbl].uv = dx11_->get_shared_data()->tex_uv_white_pixel;
+	vertex_current_ptr[fbl].uv = tex_uv_white_pixel_;
 	vertex_current_ptr[fbl].col = col.rgba;
 	vertex_current_ptr[fbr].pos = points[fbr];
-	vertex_current_ptr[fbr].uv = dx11_->get_shared_data()->tex_uv_white_pixel;
+	vertex_current_ptr[fbr].uv = tex_uv_white_pixel_;
 	vertex_current_ptr[fbr].col = col.rgba;
 
 	vertex_current_ptr += 4;
 	vertex_current_index += 4;
 	index_current_ptr += 6;
+
+	end_untransformed();
 }
 
 void renderer::buffer::draw_extents(std::span<glm::vec3, 8> points, const color_rgba& col) {
+	if (const auto [min, max] = get_bounds(points); !get_frustum().test_aabb(min, max))
+		return;
+
 	constexpr int ftl = 0;
 	constexpr int ftr = 1;
 	constexpr int fbl = 2;
@@ -1188,26 +1777,38 @@ void renderer::buffer::draw_extents(std::span<glm::vec3, 8> points, const color_
 	constexpr int bbl = 6;
 	constexpr int bbr = 7;
 
+	const D3D11_PRIMITIVE_TOPOLOGY topology = header_.topology;
+	set_topology(D3D11_PRIMITIVE_TOPOLOGY_LINELIST);
+	begin_untransformed();
+	prim_reserve(24, 24);
+
 	// Back face
-	draw_line(points[btl], points[btr], col);
-	draw_line(points[btr], points[bbr], col);
-	draw_line(points[bbr], points[bbl], col);
-	draw_line(points[bbl], points[btl], col);
+	prim_line(points[btl], points[btr], col);
+	prim_line(points[btr], points[bbr], col);
+	prim_line(points[bbr], points[bbl], col);
+	prim_line(points[bbl], points[btl], col);
 
 	// Middle lines
-	draw_line(points[ftl], points[btl], col);
-	draw_line(points[ftr], points[btr], col);
-	draw_line(points[fbl], points[bbl], col);
-	draw_line(points[fbr], points[bbr], col);
+	prim_line(points[ftl], points[btl], col);
+	prim_line(points[ftr], points[btr], col);
+	prim_line(points[fbl], points[bbl], col);
+	prim_line(points[fbr], points[bbr], col);
 
 	// Front face
-	draw_line(points[ftl], points[ftr], col);
-	draw_line(points[ftr], points[fbr], col);
-	draw_line(points[fbr], points[fbl], col);
-	draw_line(points[fbl], points[ftl], col);
+	prim_line(points[ftl], points[ftr], col);
+	prim_line(points[ftr], points[fbr], col);
+	prim_line(points[fbr], points[fbl], col);
+	prim_line(points[fbl], points[ftl], col);
+
+	end_untransformed();
+	set_topology(topology);
 }
 
 void renderer::buffer::draw_filled_extents(std::span<glm::vec3, 8> points, const color_rgba& col) {
+	if (const auto [min, max] = get_bounds(points); !get_frustum().test_aabb(min, max))
+		return;
+
+	begin_untransformed();
 	prim_reserve(36, 8);
 
 	constexpr int ftl = 0;
@@ -1270,71 +1871,212 @@ void renderer::buffer::draw_filled_extents(std::span<glm::vec3, 8> points, const
 	index_current_ptr[35] = idx + bbr;
 
 	vertex_current_ptr[ftl].pos = points[ftl];
-	vertex_current_ptr[ftl].uv = dx11_->get_shared_data()->tex_uv_white_pixel;
+	vertex_current_ptr[ftl].uv = tex_uv_white_pixel_;
 	vertex_current_ptr[ftl].col = col.rgba;
 	vertex_current_ptr[ftr].pos = points[ftr];
-	vertex_current_ptr[ftr].uv = dx11_->get_shared_data()->tex_uv_white_pixel;
+	vertex_current_ptr[ftr].uv = tex_uv_white_pixel_;
 	vertex_current_ptr[ftr].col = col.rgba;
 	vertex_current_ptr[fbl].pos = points[fbl];
-	vertex_current_ptr[fbl].uv = dx11_->get_shared_data()->tex_uv_white_pixel;
+	vertex_current_ptr[fbl].uv = tex_uv_white_pixel_;
 	vertex_current_ptr[fbl].col = col.rgba;
 	vertex_current_ptr[fbr].pos = points[fbr];
-	vertex_current_ptr[fbr].uv = dx11_->get_shared_data()->tex_uv_white_pixel;
+	vertex_current_ptr[fbr].uv = tex_uv_white_pixel_;
 	vertex_current_ptr[fbr].col = col.rgba;
 	vertex_current_ptr[btl].pos = points[btl];
-	vertex_current_ptr[btl].uv = dx11_->get_shared_data()->tex_uv_white_pixel;
+	vertex_current_ptr[btl].uv = tex_uv_white_pixel_;
 	vertex_current_ptr[btl].col = col.rgba;
 	vertex_current_ptr[btr].pos = points[btr];
-	vertex_current_ptr[btr].uv = dx11_->get_shared_data()->tex_uv_white_pixel;
+	vertex_current_ptr[btr].uv = tex_uv_white_pixel_;
 	vertex_current_ptr[btr].col = col.rgba;
 	vertex_current_ptr[bbl].pos = points[bbl];
-	vertex_current_ptr[bbl].uv = dx11_->get_shared_data()->tex_uv_white_pixel;
+	vertex_current_ptr[bbl].uv = tex_uv_white_pixel_;
 	vertex_current_ptr[bbl].col = col.rgba;
 	vertex_current_ptr[bbr].pos = points[bbr];
-	vertex_current_ptr[bbr].uv = dx11_->get_shared_data()->tex_uv_white_pixel;
+	vertex_current_ptr[bbr].uv = tex_uv_white_pixel_;
 	vertex_current_ptr[bbr].col = col.rgba;
 	vertex_current_ptr += 8;
 	vertex_current_index += 8;
 	index_current_ptr += 32;
+
+	end_untransformed();
 }
 
 void renderer::buffer::draw_sphere(const glm::vec3& center,
 								   float radius,
 								   glm::vec3 rotation,
 								   const renderer::color_rgba& col) {
-	constexpr size_t segments = 10;
-	static std::vector<glm::vec3> precomputed_points;
-	if (precomputed_points.empty()) {
-		for (size_t i = 0; i < segments; i++) {
-			const float theta = static_cast<float>(i) / static_cast<float>(segments) * M_PI * 2.0f;
-			const float st = std::sin(theta);
-			const float ct = cos_approximation(theta);
-
-			for (size_t j = 0; j < segments + 1; j++) {
-				const float phi = static_cast<float>(j) / static_cast<float>(segments) * M_PI;
-				const float sp = std::sin(phi);
-				const float cp = cos_approximation(phi);
-
-				precomputed_points.emplace_back(radius * sp * ct, radius * cp, radius * sp * st);
-			}
+	const wireframe_instance instance{ center, glm::vec3(radius), glm::quat(rotation), col };
+	draw_wireframes(wireframe_shape::sphere, std::span(&instance, 1));
+}
+
+void renderer::buffer::draw_lines3d(std::span<const line3d> lines) {
+	if (lines.empty())
+		return;
+
+	constexpr size_t parallel_grain = 16384;
+
+	const D3D11_PRIMITIVE_TOPOLOGY topology = header_.topology;
+	set_topology(D3D11_PRIMITIVE_TOPOLOGY_LINELIST);
+	begin_untransformed();
+	prim_reserve(lines.size() * 2, lines.size() * 2);
+
+	vertex* const vtx_write = vertex_current_ptr;
+	uint32_t* const idx_write = index_current_ptr;
+	const uint32_t vtx_base = vertex_current_index;
+	const glm::vec2 uv = tex_uv_white_pixel_;
+
+	const auto write = [&](size_t first, size_t last) {
+		for (size_t i = first; i < last; i++) {
+			vertex* vtx = vtx_write + i * 2;
+			vtx[0].pos = lines[i].p1;
+			vtx[0].uv = uv;
+			vtx[0].col = lines[i].col.rgba;
+			vtx[1].pos = lines[i].p2;
+			vtx[1].uv = uv;
+			vtx[1].col = lines[i].col.rgba;
+			idx_write[i * 2] = vtx_base + (uint32_t)i * 2;
+			idx_write[i * 2 + 1] = vtx_base + (uint32_t)i * 2 + 1;
 		}
+	};
+
+	if (lines.size() > parallel_grain)
+		job_system::get_default().parallel_for(0, lines.size(), parallel_grain, write);
+	else
+		write(0, lines.size());
+
+	vertex_current_ptr += lines.size() * 2;
+	index_current_ptr += lines.size() * 2;
+	vertex_current_index += (int32_t)(lines.size() * 2);
+
+	end_untransformed();
+	set_topology(topology);
+}
+
+void renderer::buffer::draw_wireframes(const wireframe_mesh& mesh, std::span<const wireframe_instance> instances) {
+	if (instances.empty() || mesh.indices.empty())
+		return;
+
+	cull_wireframes(mesh.radius, instances);
+	emit_wireframes(mesh, instances, cull_visible_);
+}
+
+void renderer::buffer::draw_wireframes(wireframe_shape shape, std::span<const wireframe_instance> instances) {
+	const shared_data* shared = dx11_->get_shared_data();
+	if (shape != wireframe_shape::sphere) {
+		draw_wireframes(shared->wireframes[(size_t)shape], instances);
+		return;
 	}
 
-	for (size_t i = 0; i < precomputed_points.size(); i++) {
-		const glm::vec3& current_point = precomputed_points[i];
+	if (instances.empty())
+		return;
 
-		// Calculate index of the next point
-		size_t next_index = (i + 1) % precomputed_points.size();
-		if ((i + 1) % (segments + 1) == 0) {
-			// Skip the last point of each segment's circle
-			continue;
+	cull_wireframes(1.f, instances, shared->sphere_lod_radius);
+	for (size_t lod = 0; lod < shared->sphere_lod_count; lod++) {
+		cull_lod_visible_.clear();
+		for (size_t i = 0; i < cull_visible_.size(); i++) {
+			if (cull_lods_[i] == lod)
+				cull_lod_visible_.push_back(cull_visible_[i]);
 		}
 
-		const glm::vec3& next_point = precomputed_points[next_index];
+		emit_wireframes(shared->sphere_lods[lod], instances, cull_lod_visible_);
+	}
+}
+
+void renderer::buffer::cull_wireframes(float mesh_radius,
+									   std::span<const wireframe_instance> instances,
+									   std::span<const float> lod_radius) {
+	cull_bounds_.resize(instances.size());
+	for (size_t i = 0; i < instances.size(); i++) {
+		const glm::vec3 scale = glm::abs(instances[i].scale);
+		cull_bounds_[i] = glm::vec4(instances[i].center, mesh_radius * std::max({ scale.x, scale.y, scale.z }));
+	}
+
+	const frustum& view = get_frustum();
+	cull_visible_.clear();
+	view.cull_spheres(cull_bounds_, cull_visible_);
+
+	const glm::vec4& viewport = dx11_->get_shared_data()->full_clip_rect;
+	const float viewport_height = viewport.w - viewport.y;
+
+	// Anything under half a pixel would at best light up a single pixel
+	size_t kept = 0;
+	cull_lods_.clear();
+	for (const uint32_t i : cull_visible_) {
+		const float radius = view.get_projected_radius(glm::vec3(cull_bounds_[i]), cull_bounds_[i].w, viewport_height);
+		if (radius < 0.5f)
+			continue;
 
-		// Draw the line between current_point and next_point
-		draw_line(center + current_point, center + next_point, col);
+		cull_visible_[kept++] = i;
+		cull_lods_.push_back((uint8_t)(std::ranges::upper_bound(lod_radius, radius) - lod_radius.begin()));
 	}
+
+	cull_visible_.resize(kept);
+}
+
+void renderer::buffer::emit_wireframes(const wireframe_mesh& mesh,
+									   std::span<const wireframe_instance> instances,
+									   std::span<const uint32_t> visible) {
+	if (visible.empty() || mesh.indices.empty())
+		return;
+
+	constexpr size_t parallel_vertices = 65536;
+
+	const size_t vtx_count = mesh.vertices.size();
+	const size_t idx_count = mesh.indices.size();
+
+	const D3D11_PRIMITIVE_TOPOLOGY topology = header_.topology;
+	set_topology(D3D11_PRIMITIVE_TOPOLOGY_LINELIST);
+	begin_untransformed();
+	prim_reserve(idx_count * visible.size(), vtx_count * visible.size());
+
+	vertex* const vtx_write = vertex_current_ptr;
+	uint32_t* const idx_write = index_current_ptr;
+	const uint32_t vtx_base = vertex_current_index;
+	const glm::vec2 uv = tex_uv_white_pixel_;
+
+	// Each instance owns a fixed slice, its rotation and scale are folded into one basis held in SSE lanes so every
+	// vertex is three multiply-adds and one store
+	const auto write = [&](size_t first, size_t last) {
+		for (size_t i = first; i < last; i++) {
+			const wireframe_instance& instance = instances[visible[i]];
+			const glm::mat3 basis = glm::mat3_cast(instance.rotation);
+			const glm::vec3 x = basis[0] * instance.scale.x;
+			const glm::vec3 y = basis[1] * instance.scale.y;
+			const glm::vec3 z = basis[2] * instance.scale.z;
+
+			const __m128 x_lanes = _mm_setr_ps(x.x, x.y, x.z, 0.f);
+			const __m128 y_lanes = _mm_setr_ps(y.x, y.y, y.z, 0.f);
+			const __m128 z_lanes = _mm_setr_ps(z.x, z.y, z.z, 0.f);
+			const __m128 center = _mm_setr_ps(instance.center.x, instance.center.y, instance.center.z, 0.f);
+
+			vertex* vtx = vtx_write + i * vtx_count;
+			for (size_t v = 0; v < vtx_count; v++) {
+				const glm::vec3& p = mesh.vertices[v];
+				const __m128 pos = _mm_add_ps(_mm_add_ps(center, _mm_mul_ps(x_lanes, _mm_set1_ps(p.x))),
+											  _mm_add_ps(_mm_mul_ps(y_lanes, _mm_set1_ps(p.y)),
+														 _mm_mul_ps(z_lanes, _mm_set1_ps(p.z))));
+				store_vertex_pos(&vtx[v], pos);
+				vtx[v].uv = uv;
+				vtx[v].col = instance.col.rgba;
+			}
+
+			store_rebased_indices(
+			idx_write + i * idx_count, mesh.indices.data(), idx_count, (uint32_t)(vtx_base + i * vtx_count));
+		}
+	};
+
+	if (visible.size() * vtx_count > parallel_vertices)
+		job_system::get_default().parallel_for(
+		0, visible.size(), std::max<size_t>(parallel_vertices / std::max<size_t>(vtx_count, 1), 1), write);
+	else
+		write(0, visible.size());
+
+	vertex_current_ptr += vtx_count * visible.size();
+	index_current_ptr += idx_count * visible.size();
+	vertex_current_index += (int32_t)(vtx_count * visible.size());
+
+	end_untransformed();
+	set_topology(topology);
 }
 
 renderer::shared_data::shared_data() {
@@ -1346,6 +2088,47 @@ renderer::shared_data::shared_data() {
 
 	arc_fast_radius_cutoff =
 	circle_segment_max_error / (1 - cosf(M_PI / std::max((float)arc_fast_vtx_size, (float)M_PI)));
+
+	const auto add_line = [](wireframe_mesh& mesh, size_t a, size_t b) {
+		mesh.indices.push_back((uint32_t)a);
+		mesh.indices.push_back((uint32_t)b);
+	};
+
+	wireframe_mesh& box = wireframes[(size_t)wireframe_shape::box];
+	for (size_t i = 0; i < 8; i++)
+		box.vertices.emplace_back(i & 1 ? 1.f : -1.f, i & 2 ? 1.f : -1.f, i & 4 ? 1.f : -1.f);
+	// Corners one bit apart share an edge
+	for (size_t i = 0; i < 8; i++) {
+		for (size_t bit = 1; bit < 8; bit <<= 1) {
+			if (!(i & bit))
+				add_line(box, i, i | bit);
+		}
+	}
+	box.radius = std::sqrt(3.f);
+
+	// Rings and slices
+	constexpr std::pair<size_t, size_t> sphere_lod_detail[sphere_lod_count] = {
+		{ 3, 6 }, { 4, 8 }, { 6, 12 }, { 10, 20 }
+	};
+	for (size_t lod = 0; lod < sphere_lod_count; lod++)
+		build_wireframe_sphere(sphere_lods[lod], sphere_lod_detail[lod].first, sphere_lod_detail[lod].second);
+	wireframes[(size_t)wireframe_shape::sphere] = sphere_lods.back();
+
+	// Top and bottom circle joined by four side lines
+	wireframe_mesh& cylinder = wireframes[(size_t)wireframe_shape::cylinder];
+	for (size_t i = 0; i < cylinder_segments; i++) {
+		const float a = (float)i / (float)cylinder_segments * pi_2_f;
+		cylinder.vertices.emplace_back(cosf(a), 1.f, sinf(a));
+		cylinder.vertices.emplace_back(cosf(a), -1.f, sinf(a));
+	}
+	for (size_t i = 0; i < cylinder_segments; i++) {
+		const size_t next = (i + 1) % cylinder_segments;
+		add_line(cylinder, i * 2, next * 2);
+		add_line(cylinder, i * 2 + 1, next * 2 + 1);
+		if (i % (cylinder_segments / 4) == 0)
+			add_line(cylinder, i * 2, i * 2 + 1);
+	}
+	cylinder.radius = std::sqrt(2.f);
 }
 
 void renderer::shared_data::set_circle_segment_max_error(float max_error) {
@@ -1368,21 +2151,26 @@ void renderer::shared_data::set_circle_segment_max_error(float max_error) {
 	circle_segment_max_error / (1 - cosf(M_PI / std::max((float)arc_fast_vtx_size, (float)M_PI)));
 }
 
-// Compare ClipRect, TextureId and VtxOffset with a single memcmp()
-#define DRAW_CMD_HEADER_SIZE (offsetof(draw_command, vtx_offset) + sizeof(unsigned int))
-#define DRAW_CMD_HEADER_COMPARE(CMD_LHS, CMD_RHS) \
-	(memcmp(CMD_LHS, CMD_RHS, DRAW_CMD_HEADER_SIZE))// Compare ClipRect, TextureId, VtxOffset
-#define DRAW_CMD_HEADER_COPY(CMD_DST, CMD_SRC) \
-	(memcpy(CMD_DST, CMD_SRC, DRAW_CMD_HEADER_SIZE))// Copy ClipRect, TextureId, VtxOffset
+// Compare ClipRect, Topology, TextureId and VtxOffset, field by field since padding makes a memcmp() unreliable
+#define DRAW_CMD_HEADER_COMPARE(HEADER, CMD) \
+	((HEADER)->clip_rect == (CMD)->clip_rect && (HEADER)->topology == (CMD)->topology && \
+	 (HEADER)->texture == (CMD)->texture && (HEADER)->vtx_offset == (CMD)->vtx_offset)
 #define DRAW_CMD_ARE_SEQUENTIAL_IDX_OFFSET(CMD_0, CMD_1) (CMD_0->idx_offset + CMD_0->elem_count == CMD_1->idx_offset)
 
 void renderer::buffer::push_scissor(const glm::vec4& bounds) {
+	if (deferred_ && !shapes_.empty())
+		record_shape({ .type{ shape_type::push_scissor },
+					   .points{ glm::vec2(bounds.x, bounds.y), glm::vec2(bounds.z, bounds.w) } });
+
 	scissor_stack_.push_back(bounds);
 	header_.clip_rect = bounds;
 	update_scissor();
 }
 
 void renderer::buffer::pop_scissor() {
+	if (deferred_ && !shapes_.empty())
+		record_shape({ .type{ shape_type::pop_scissor } });
+
 	scissor_stack_.pop_back();
 	header_.clip_rect =
 	(scissor_stack_.Size == 0) ? dx11_->get_shared_data()->full_clip_rect : scissor_stack_.Data[scissor_stack_.Size - 1];
@@ -1390,17 +2178,60 @@ void renderer::buffer::pop_scissor() {
 }
 
 void renderer::buffer::push_texture(ID3D11ShaderResourceView* srv) {
+	if (deferred_ && !shapes_.empty()) {
+		record_shape({ .type{ shape_type::push_texture }, .segments{ (uint32_t)shape_textures_.Size } });
+		shape_textures_.push_back(srv);
+	}
+
 	texture_stack_.push_back(srv);
 	header_.texture = srv;
 	update_texture();
 }
 
 void renderer::buffer::pop_texture() {
+	if (deferred_ && !shapes_.empty())
+		record_shape({ .type{ shape_type::pop_texture } });
+
 	texture_stack_.pop_back();
 	header_.texture = (texture_stack_.Size == 0) ? nullptr : texture_stack_.Data[texture_stack_.Size - 1];
 	update_texture();
 }
 
+void renderer::buffer::push_transform(const glm::mat3x2& transform) {
+	if (deferred_ && !shapes_.empty())
+		record_shape({ .type{ shape_type::push_transform }, .points{ transform[0], transform[1], transform[2] } });
+
+	flush_transform();
+	transform_stack_.push_back(compose_transform(get_transform(), transform));
+	transform_identity_ = transform_stack_.back() == glm::mat3x2(1.f);
+}
+
+void renderer::buffer::pop_transform() {
+	if (deferred_ && !shapes_.empty())
+		record_shape({ .type{ shape_type::pop_transform } });
+
+	flush_transform();
+	transform_stack_.pop_back();
+	transform_identity_ = transform_stack_.empty() || transform_stack_.back() == glm::mat3x2(1.f);
+}
+
+glm::mat3x2 renderer::buffer::get_transform() const {
+	return transform_stack_.empty() ? glm::mat3x2(1.f) : transform_stack_.back();
+}
+
+void renderer::buffer::flush_transform() {
+	if (!transform_identity_) {
+		const glm::mat3x2& transform = transform_stack_.back();
+		for (vertex* vtx = vertices_.Data + transform_vtx_start_; vtx != vertices_.Data + vertices_.Size; vtx++) {
+			const glm::vec2 pos = transform * glm::vec3(vtx->pos.x, vtx->pos.y, 1.f);
+			vtx->pos.x = pos.x;
+			vtx->pos.y = pos.y;
+		}
+	}
+
+	transform_vtx_start_ = vertices_.Size;
+}
+
 void renderer::buffer::update_texture() {
 	auto* curr_cmd = &draw_cmds_.Data[draw_cmds_.Size - 1];
 	if (curr_cmd->elem_count != 0 && curr_cmd->texture != header_.texture) {
@@ -1409,7 +2240,7 @@ void renderer::buffer::update_texture() {
 	}
 
 	auto* prev_cmd = curr_cmd - 1;
-	if (curr_cmd->elem_count == 0 && draw_cmds_.Size > 1 && DRAW_CMD_HEADER_COMPARE(&header_, prev_cmd) == 0 && DRAW_CMD_ARE_SEQUENTIAL_IDX_OFFSET(prev_cmd, curr_cmd)) {
+	if (curr_cmd->elem_count == 0 && draw_cmds_.Size > 1 && DRAW_CMD_HEADER_COMPARE(&header_, prev_cmd) && DRAW_CMD_ARE_SEQUENTIAL_IDX_OFFSET(prev_cmd, curr_cmd)) {
 		draw_cmds_.pop_back();
 		return;
 	}
@@ -1417,6 +2248,38 @@ void renderer::buffer::update_texture() {
 	curr_cmd->texture = header_.texture;
 }
 
+void renderer::buffer::switch_text_texture(ID3D11ShaderResourceView* srv,
+											size_t& idx_expected_size,
+											size_t glyphs_left) {
+	// Give back the unwritten part of the reservation before the command is split
+	vertices_.Size = (int)(vertex_current_ptr - vertices_.Data);
+	indices_.Size = (int)(index_current_ptr - indices_.Data);
+	draw_cmds_.back().elem_count -= idx_expected_size - indices_.Size;
+
+	header_.texture = srv;
+	update_texture();
+
+	prim_reserve(glyphs_left * 6, glyphs_left * 4);
+	idx_expected_size = indices_.Size;
+}
+
+void renderer::buffer::update_topology() {
+	auto* curr_cmd = &draw_cmds_.Data[draw_cmds_.Size - 1];
+	if (curr_cmd->elem_count != 0 && curr_cmd->topology != header_.topology) {
+		add_draw_cmd();
+		return;
+	}
+
+	auto* prev_cmd = curr_cmd - 1;
+	if (curr_cmd->elem_count == 0 && draw_cmds_.Size > 1 && DRAW_CMD_HEADER_COMPARE(&header_, prev_cmd) &&
+		DRAW_CMD_ARE_SEQUENTIAL_IDX_OFFSET(prev_cmd, curr_cmd)) {
+		draw_cmds_.pop_back();
+		return;
+	}
+
+	curr_cmd->topology = header_.topology;
+}
+
 void renderer::buffer::update_scissor() {
 	auto* curr_cmd = &draw_cmds_.Data[draw_cmds_.Size - 1];
 	if (curr_cmd->elem_count == 0 && memcmp(&curr_cmd->clip_rect, &header_.clip_rect, sizeof(glm::vec4)) != 0) {
@@ -1425,7 +2288,7 @@ void renderer::buffer::update_scissor() {
 	}
 
 	auto* prev_cmd = curr_cmd - 1;
-	if (curr_cmd->elem_count == 0 && draw_cmds_.Size > 1 && DRAW_CMD_HEADER_COMPARE(&header_, prev_cmd) == 0 &&
+	if (curr_cmd->elem_count == 0 && draw_cmds_.Size > 1 && DRAW_CMD_HEADER_COMPARE(&header_, prev_cmd) &&
 		DRAW_CMD_ARE_SEQUENTIAL_IDX_OFFSET(prev_cmd, curr_cmd)) {
 		draw_cmds_.pop_back();
 		return;
@@ -1451,19 +2314,34 @@ const glm::mat4x4& renderer::buffer::get_projection() const {
 
 void renderer::buffer::set_projection(const glm::mat4x4& projection) {
 	active_projection_ = projection;
+	frustum_dirty_ = true;
+}
+
+const renderer::frustum& renderer::buffer::get_frustum() {
+	if (frustum_dirty_) {
+		frustum_ = frustum(active_projection_);
+		frustum_dirty_ = false;
+	}
+
+	return frustum_;
 }
 
 D3D11_PRIMITIVE_TOPOLOGY renderer::buffer::get_topology() const {
-	return topology_;
+	return header_.topology;
 }
 
 void renderer::buffer::set_topology(D3D11_PRIMITIVE_TOPOLOGY topology) {
-	topology_ = topology;
+	if (header_.topology == topology)
+		return;
+
+	header_.topology = topology;
+	update_topology();
 }
 
 void renderer::buffer::add_draw_cmd() {
 	draw_command cmd;
 	cmd.clip_rect = header_.clip_rect;
+	cmd.topology = header_.topology;
 	cmd.texture = header_.texture;
 	cmd.vtx_offset = header_.vtx_offset;
 	cmd.idx_offset = indices_.Size;
@@ -1472,6 +2350,12 @@ void renderer::buffer::add_draw_cmd() {
 }
 
 int renderer::buffer::calc_circle_auto_segment_count(float radius) const {
+	// Segments follow the size on screen, so scaled up circles get more and scaled down ones fewer
+	if (!transform_identity_) {
+		const glm::mat3x2& transform = transform_stack_.back();
+		radius *= std::sqrt(std::max(glm::dot(transform[0], transform[0]), glm::dot(transform[1], transform[1])));
+	}
+
 	// Automatic segment count
 	const int radius_idx = (int)(radius + 0.999999f);// ceil to never reduce accuracy
 	if (radius_idx >= 0 && radius_idx < dx11_->get_shared_data()->arc_fast_vtx_size)
@@ -1,70 +1,259 @@
 #include "renderer/font.hpp"
 
+#include "renderer/util/compression.hpp"
+#include "renderer/util/hash.hpp"
+#include "renderer/util/job_system.hpp"
+#include "renderer/util/mapped_file.hpp"
+#include "renderer/util/rect_packer.hpp"
+
 #include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <emmintrin.h>
 #include <freetype/freetype.h>
+#include <freetype/ftoutln.h>
 #include <freetype/ftsynth.h>
 #include <fstream>
 #include <ranges>
+#include <span>
 
 #define STB_RECT_PACK_IMPLEMENTATION
 #include "renderer/util/stb_rect_pack.hpp"
 
 namespace renderer {
+	namespace {
+		constexpr uint32_t cache_magic = 0x52544C41;
+
+		struct cache_header {
+			uint32_t magic = cache_magic;
+			uint32_t version = font_atlas::cache_version;
+			uint64_t key = 0;
+			uint32_t font_count = 0;
+			uint32_t custom_rect_count = 0;
+			uint32_t white_pixel_id = 0;
+			uint32_t lines_id = 0;
+			uint32_t page_count = 0;
+			glm::vec2 tex_uv_white_pixel{};
+			glm::vec4 tex_uv_lines[64]{};
+		};
+
+		struct cache_page {
+			glm::vec2 size{};
+			uint64_t pixels_size = 0;
+		};
+
+		struct cache_font {
+			int32_t config_index = -1;
+			uint32_t fallback_char = 0;
+			float size = 0.0f, ascent = 0.0f, descent = 0.0f;
+			uint32_t glyph_count = 0;
+			uint32_t merged_glyphs_offset = 0;
+			uint32_t lookup_page_count = 0;
+			uint32_t lookup_slot_count = 0;
+		};
+
+		struct cache_custom_rect {
+			glm::vec4 size{};
+			uint32_t glyph_id = 0;
+			float glyph_advance_x = 0.0f;
+			glm::vec2 glyph_offset{};
+			int32_t font_index = -1;
+		};
+
+		static_assert(std::is_trivially_copyable_v<text_font::glyph>);
+
+		// Bounds checked cursor over the mapped cache
+		struct cache_reader {
+			const uint8_t* ptr = nullptr;
+			const uint8_t* end = nullptr;
+
+			template<typename T>
+			bool read(T& value) {
+				return read_array(&value, 1);
+			}
+
+			template<typename T>
+			bool read_array(T* dst, size_t count) {
+				const size_t size = count * sizeof(T);
+				if ((size_t)(end - ptr) < size)
+					return false;
+
+				memcpy(dst, ptr, size);
+				ptr += size;
+				return true;
+			}
+		};
+
+		template<typename T>
+		void write_array(std::ofstream& file, const T* data, size_t count) {
+			file.write(reinterpret_cast<const char*>(data), (std::streamsize)(count * sizeof(T)));
+		}
+
+		template<typename T>
+		void write_value(std::ofstream& file, const T& value) {
+			write_array(file, &value, 1);
+		}
+	}// namespace
+
+	font_blob::font_blob(std::vector<char> data) : font_blob(std::move(data), 0) {
+		identity_ = hash_bytes(hash_seed, data_, size_);
+	}
+
+	font_blob::font_blob(std::vector<char> data, uint64_t identity) : owned_(std::move(data)), identity_(identity) {
+		data_ = reinterpret_cast<const uint8_t*>(owned_.data());
+		size_ = owned_.size();
+	}
+
+	font_blob::font_blob(mapped_file file, std::string_view filename) : mapped_(std::move(file)) {
+		data_ = mapped_.data();
+		size_ = mapped_.size();
+
+		identity_ = hash_bytes(hash_seed, filename.data(), filename.size());
+		identity_ = hash_value(identity_, size_);
+		identity_ = hash_value(identity_, mapped_.get_last_write_time());
+	}
+
 	void text_font::build_lookup_table() {
+		// Drop the merged and tab glyphs from the last build
+		glyphs.resize(merged_glyphs_offset);
+		if (glyphs.empty()) {
+			return;
+		}
+
 		const uint32_t max_codepoint =
 		std::ranges::max_element(glyphs, [](const glyph& a, const glyph& b) { return a.codepoint < b.codepoint; })
 		->codepoint;
 
-		if (glyphs.size() >= std::numeric_limits<uint16_t>::max()) {
-			return;
+		lookup_table.clear(max_codepoint);
+
+		for (uint32_t i : std::views::iota(0u, glyphs.size())) {
+			if (glyphs[i].subpixel_phases)
+				lookup_table.set(glyphs[i].codepoint, glyphs[i].advance_x, i);
 		}
 
-		lookup_table = font_lookup_table{};
-		lookup_table.resize(max_codepoint + 1);
+		// Merging copies the fallback glyphs in so draw_text still does a single lookup per code point
+		for (const text_font* fallback_font : fallback_fonts) {
+			if (!fallback_font->is_loaded() || fallback_font->container_atlas != container_atlas)
+				continue;
 
-		for (uint32_t i : std::views::iota(0u, glyphs.size())) {
-			const uint32_t codepoint = glyphs[i].codepoint;
-			lookup_table.advances_x[codepoint] = glyphs[i].advance_x;
-			lookup_table.indexes[codepoint] = (uint16_t)i;
+			// Glyphs are scaled to this font's size around the baseline, the corners already include the ascent of their
+			// own font. Scaled variants would no longer line up with the phase they're picked for so only the glyph
+			// itself is kept then
+			const float scale = fallback_font->size > 0.0f ? size / fallback_font->size : 1.0f;
+			const bool scaled = scale != 1.0f;
+			const float ascent_from = round(fallback_font->ascent), ascent_to = round(ascent);
+			const std::span fallback_glyphs(fallback_font->glyphs.data(), fallback_font->merged_glyphs_offset);
+			for (const glyph& src_glyph : fallback_glyphs) {
+				if (!src_glyph.subpixel_phases ||
+					lookup_table.indexes[lookup_table.get_slot(src_glyph.codepoint)] != font_lookup_table::empty_index)
+					continue;
+
+				// The subpixel variants are copied right after the glyph they belong to
+				const auto merged_index = (uint32_t)glyphs.size();
+				const uint32_t phases = scaled ? 1 : src_glyph.subpixel_phases;
+				for (uint32_t phase : std::views::iota(0u, phases)) {
+					glyph& merged_glyph =
+					glyphs.emplace_back(phase ? fallback_glyphs[src_glyph.subpixel_offset + phase - 1] : src_glyph);
+					merged_glyph.corners.x *= scale;
+					merged_glyph.corners.z *= scale;
+					merged_glyph.corners.y = (merged_glyph.corners.y - ascent_from) * scale + ascent_to;
+					merged_glyph.corners.w = (merged_glyph.corners.w - ascent_from) * scale + ascent_to;
+					merged_glyph.advance_x *= scale;
+				}
+
+				glyphs[merged_index].subpixel_phases = phases;
+				glyphs[merged_index].subpixel_offset = merged_index + 1;
+				lookup_table.set(src_glyph.codepoint, glyphs[merged_index].advance_x, merged_index);
+			}
 		}
 
 		if (find_glyph(' ')) {
-			if (glyphs.back().codepoint != '\t')
-				glyphs.resize(glyphs.size() + 1);
+			glyphs.resize(glyphs.size() + 1);
 			glyph& tab_glyph = glyphs.back();
 			tab_glyph = *find_glyph(' ');
 			tab_glyph.codepoint = '\t';
 			tab_glyph.advance_x *= 4;
-			lookup_table.advances_x[(int)tab_glyph.codepoint] = tab_glyph.advance_x;
-			lookup_table.indexes[(int)tab_glyph.codepoint] = (uint16_t)(glyphs.size() - 1);
+			lookup_table.set(tab_glyph.codepoint, tab_glyph.advance_x, (uint32_t)(glyphs.size() - 1));
 		}
 
-		set_glyph_visible(' ', false);
-		set_glyph_visible('\t', false);
+		for (const uint32_t c : { U' ', U'\t' }) {
+			if (glyph* glyph = find_glyph(c))
+				glyph->visible = false;
+		}
 
 		fallback_glyph = find_glyph(fallback_char, false);
 		fallback_advance_x = fallback_glyph ? fallback_glyph->advance_x : 0.0f;
-		for (uint32_t i : std::views::iota(0u, max_codepoint + 1))
-			if (lookup_table.advances_x[i] < 0.0f)
-				lookup_table.advances_x[i] = fallback_advance_x;
+		for (float& advance_x : lookup_table.advances_x)
+			if (advance_x < 0.0f)
+				advance_x = fallback_advance_x;
+
+		lookup_table.dirty = false;
+	}
+
+	bool text_font::add_fallback_font(text_font* font) {
+		if (!font || font == this || std::ranges::contains(fallback_fonts, font)) {
+			return false;
+		}
+
+		if (container_atlas && font->container_atlas && container_atlas != font->container_atlas) {
+			return false;
+		}
+
+		fallback_fonts.push_back(font);
+		lookup_table.dirty = true;
+
+		if (is_loaded() && font->is_loaded()) {
+			build_lookup_table();
+			container_atlas->republish_snapshot(this);
+		}
+
+		return true;
+	}
+
+	void text_font::set_fallback_char(const uint16_t c) {
+		fallback_char = c;
+		build_lookup_table();
+		if (container_atlas)
+			container_atlas->republish_snapshot(this);
+	}
+
+	void text_font::set_glyph_visible(const uint32_t c, const bool visible) {
+		set_glyph_visible(std::span(&c, 1), visible);
+	}
+
+	void text_font::set_glyph_visible(std::span<const uint32_t> codepoints, const bool visible) {
+		for (const uint32_t c : codepoints) {
+			if (glyph* glyph = find_glyph(c))
+				glyph->visible = visible;
+		}
+
+		if (container_atlas)
+			container_atlas->republish_snapshot(this);
 	}
 
-	// TODO: Investigate branchless lookup table
-	// Possible to fill every other value with fallback_glyph pointer, may increase memory size
-	// but speed up on CPU
 	text_font::glyph* text_font::find_glyph(const uint32_t c, const bool fallback) {
-		if (c >= lookup_table.indexes.size())
+		const uint32_t i = lookup_table.indexes[lookup_table.get_slot(c)];
+		if (i == font_lookup_table::empty_index)
 			return fallback ? fallback_glyph : nullptr;
 
-		const uint32_t i = lookup_table.indexes[c];
-		if (i == std::numeric_limits<uint32_t>::max())
+		return &glyphs[i];
+	}
+
+	const text_font::glyph* text_font::find_glyph(const uint32_t c, const bool fallback) const {
+		const uint32_t i = lookup_table.indexes[lookup_table.get_slot(c)];
+		if (i == font_lookup_table::empty_index)
 			return fallback ? fallback_glyph : nullptr;
 
 		return &glyphs[i];
 	}
 
-	void text_font::add_glyph(
-	font_config* cfg, uint32_t codepoint, glm::vec4 corners, const glm::vec4& texture_coordinates, float advance_x) {
+	void text_font::add_glyph(font_config* cfg,
+							  uint32_t codepoint,
+							  glm::vec4 corners,
+							  const glm::vec4& texture_coordinates,
+							  float advance_x,
+							  uint32_t page,
+							  uint32_t subpixel_phases) {
 		if (cfg) {
 			const float advance_x_original = advance_x;
 			advance_x = std::clamp(advance_x, cfg->glyph_config.min_advance_x, cfg->glyph_config.max_advance_x);
@@ -79,20 +268,48 @@ namespace renderer {
 		}
 
 		// corners.x != corners.z && corners.y != corners.w
-		glyphs.emplace_back(codepoint, true, advance_x, corners, texture_coordinates);
+		glyphs.resize(merged_glyphs_offset);
+		glyph& main_glyph =
+		glyphs.emplace_back(codepoint, true, advance_x, corners, texture_coordinates, glm::vec2{}, page);
+
+		// Variants start out as copies so a variant that failed to pack still draws something sensible
+		if (subpixel_phases > 1) {
+			main_glyph.subpixel_phases = subpixel_phases;
+			main_glyph.subpixel_offset = (uint32_t)glyphs.size();
+
+			glyph variant_glyph = main_glyph;
+			variant_glyph.subpixel_phases = 0;
+			glyphs.insert(glyphs.end(), subpixel_phases - 1, variant_glyph);
+		}
+
+		merged_glyphs_offset = glyphs.size();
 		lookup_table.dirty = true;
 	}
 
-	void font_atlas::font_texture::get_data_as_rgba32() {
+	void font_atlas::font_page::get_data_as_rgba32() {
 		if (pixels_alpha8.empty()) {
 			return;
 		}
 
 		if (pixels_rgba32.empty()) {
-			pixels_rgba32.resize(size.x * size.y * 4.0f);
+			pixels_rgba32.resize(pixels_alpha8.size());
 			const uint8_t* src = pixels_alpha8.data();
 			uint32_t* dst = pixels_rgba32.data();
-			for (int n : std::views::iota(1, size.x * size.y + 1) | std::views::reverse)
+
+			// 16 pixels at a time, interleaving 0xFF below each alpha byte twice gives 0xAAFFFFFF per pixel
+			const __m128i white = _mm_set1_epi8((char)0xFF);
+			size_t n = pixels_alpha8.size();
+			for (; n >= 16; n -= 16, src += 16, dst += 16) {
+				const __m128i alpha = _mm_loadu_si128((const __m128i*)src);
+				const __m128i lo = _mm_unpacklo_epi8(white, alpha);
+				const __m128i hi = _mm_unpackhi_epi8(white, alpha);
+				_mm_storeu_si128((__m128i*)(dst + 0), _mm_unpacklo_epi16(white, lo));
+				_mm_storeu_si128((__m128i*)(dst + 4), _mm_unpackhi_epi16(white, lo));
+				_mm_storeu_si128((__m128i*)(dst + 8), _mm_unpacklo_epi16(white, hi));
+				_mm_storeu_si128((__m128i*)(dst + 12), _mm_unpackhi_epi16(white, hi));
+			}
+
+			for (; n > 0; n--)
 				*dst++ = (*src++ << 24) | 0xFFFFFF;
 		}
 	}
@@ -110,18 +327,22 @@ namespace renderer {
 		auto* r = &custom_rects[white_pixel_id];
 		assert(r->is_packed());
 
-		const int w = (int)texture.size.x;
+		// Custom rects always live on the first page
+		font_page& page = texture.pages.front();
+		const int w = (int)page.size.x;
 		const int offset = (int)r->size.x + (int)r->size.y * w;
-		texture.pixels_alpha8[offset] = texture.pixels_alpha8[offset + 1] = texture.pixels_alpha8[offset + w] =
-		texture.pixels_alpha8[offset + w + 1] = 0xFF;
+		page.pixels_alpha8[offset] = page.pixels_alpha8[offset + 1] = page.pixels_alpha8[offset + w] =
+		page.pixels_alpha8[offset + w + 1] = 0xFF;
 
-		tex_uv_white_pixel = { (r->size.x + 0.5f) / texture.size.x, (r->size.y + 0.5f) / texture.size.y };
+		tex_uv_white_pixel = { (r->size.x + 0.5f) / page.size.x, (r->size.y + 0.5f) / page.size.y };
 	}
 
 	void font_atlas::build_render_lines_tex_data() {
 		auto* r = &custom_rects[lines_id];
 		assert(r->is_packed());
 
+		font_page& page = texture.pages.front();
+
 		for (uint32_t n = 0; n < 64; n++) {
 			// Each line consists of at least two empty pixels at the ends, with a line of solid pixels in the middle
 			unsigned int y = n;
@@ -131,7 +352,7 @@ namespace renderer {
 
 			// Write each slice
 			unsigned char* write_ptr =
-			&texture.pixels_alpha8[(int)r->size.x + (((int)r->size.y + y) * (int)texture.size.x)];
+			&page.pixels_alpha8[(int)r->size.x + (((int)r->size.y + y) * (int)page.size.x)];
 			for (unsigned int i = 0; i < pad_left; i++)
 				*(write_ptr + i) = 0x00;
 
@@ -143,9 +364,9 @@ namespace renderer {
 
 			// Calculate UVs for this line
 			glm::vec2 uv0 =
-			glm::vec2((float)(r->size.x + pad_left - 1) / texture.size.x, (float)(r->size.y + y) / texture.size.y);
-			glm::vec2 uv1 = glm::vec2((float)(r->size.x + pad_left + line_width + 1) / texture.size.x,
-									  (float)(r->size.y + y + 1) / texture.size.y);
+			glm::vec2((float)(r->size.x + pad_left - 1) / page.size.x, (float)(r->size.y + y) / page.size.y);
+			glm::vec2 uv1 = glm::vec2((float)(r->size.x + pad_left + line_width + 1) / page.size.x,
+									  (float)(r->size.y + y + 1) / page.size.y);
 			float half_v =
 			(uv0.y + uv1.y) * 0.5f;// Calculate a constant V in the middle of the row to avoid sampling artifacts
 			tex_uv_lines[n] = glm::vec4(uv0.x, half_v, uv1.x, half_v);
@@ -154,7 +375,7 @@ namespace renderer {
 
 
 	void font_atlas::build_finish() {
-		if (texture.pixels_alpha8.empty()) {
+		if (!texture.is_built()) {
 			return;
 		}
 
@@ -183,6 +404,10 @@ namespace renderer {
 			return;
 		}
 
+		if (!cache_filename.empty() && load_cache(cache_filename)) {
+			return;
+		}
+
 		FT_Library ft_library{};
 		if (auto result = FT_Init_FreeType(&ft_library); result) {
 			return;
@@ -197,7 +422,7 @@ namespace renderer {
 		  });
 		lines_id = custom_rects.size() - 1;
 
-		texture = font_texture{};
+		texture.clear();
 
 		std::vector<build_src> src_array(configs.size());
 		std::vector<build_data> dst_array(fonts.size());
@@ -220,8 +445,8 @@ namespace renderer {
 				continue;
 			}
 
-			if (auto result = FT_New_Memory_Face(ft_library, (uint8_t*)config.data.data(), (uint32_t)config.data.size(),
-												 (uint32_t)config.index, &src.freetype.face);
+			if (auto result = FT_New_Memory_Face(ft_library, config.data->data(), (FT_Long)config.data->size(),
+												 (FT_Long)config.index, &src.freetype.face);
 				result) {
 				continue;
 			}
@@ -265,6 +490,8 @@ namespace renderer {
 
 			src.freetype.render_mode = FT_RENDER_MODE_NORMAL;
 
+			src.subpixel_phases = config.pixel_snap_h ? 1 : std::clamp(config.subpixel_phases, 1u, 4u);
+
 			build_data& dst = dst_array[src.dst_index];
 			src.src_ranges =
 			config.glyph_config.ranges ? config.glyph_config.ranges : text_font::glyph::ranges_default();
@@ -311,76 +538,94 @@ namespace renderer {
 			if (src.glyphs_list.size() != src.glyphs_count) {
 				// TODO: Add assertion
 			}
+
+			// Each phase gets its own rect, they're kept directly after phase 0 of the same glyph
+			if (src.subpixel_phases > 1) {
+				std::vector<src_glyph> phased_list;
+				phased_list.reserve(src.glyphs_list.size() * src.subpixel_phases);
+				for (const src_glyph& glyph : src.glyphs_list) {
+					for (uint32_t phase : std::views::iota(0u, src.subpixel_phases))
+						phased_list.push_back({ .glyph{ glyph.glyph }, .phase{ phase } });
+				}
+
+				total_glyphs_count += (int)(phased_list.size() - src.glyphs_list.size());
+				src.glyphs_list = std::move(phased_list);
+				src.glyphs_count = (int)src.glyphs_list.size();
+			}
 		}
 
-		int total_surface{}, buf_rects_out_n{}, buf_packedchars_out_n{};
+		// Both passes load glyphs the same way so the box measured for packing is the one that gets rendered
+		const auto load_glyph = [](build_src& src, const src_glyph& glyph, FT_Pos* hinted_advance_x = nullptr) {
+			if (auto result = FT_Load_Glyph(src.freetype.face, glyph.glyph_index, src.freetype.flags); result)
+				return false;
+
+			const FT_GlyphSlot slot = src.freetype.face->glyph;
+			if (hinted_advance_x)
+				*hinted_advance_x = slot->advance.x;
+
+			if (src.freetype.rasterizer_flags & rasterizer_flags::bold)
+				FT_GlyphSlot_Embolden(slot);
+
+			if (src.freetype.rasterizer_flags & rasterizer_flags::oblique)
+				FT_GlyphSlot_Oblique(slot);
+
+			if (glyph.phase && slot->format == FT_GLYPH_FORMAT_OUTLINE)
+				FT_Outline_Translate(&slot->outline, (FT_Pos)(glyph.phase * 64 / src.subpixel_phases), 0);
+
+			return true;
+		};
+
+		// Metrics only, outlines are measured from their control box instead of being rendered
+		int total_surface{}, buf_rects_out_n{};
 		std::vector<stbrp_rect> buf_rects((size_t)total_glyphs_count);
-		for (const auto&& [src, config] : std::views::zip(src_array, configs)) {
+		for (build_src& src : src_array) {
 			src.rects = &buf_rects[buf_rects_out_n];
 			buf_rects_out_n += src.glyphs_count;
 
 			for (uint32_t i : std::views::iota(0u, src.glyphs_list.size())) {
 				auto& glyph = src.glyphs_list[i];
-				std::uint32_t glyph_index = FT_Get_Char_Index(src.freetype.face, glyph.glyph.codepoint);
-				if (!glyph_index) {
+				glyph.glyph_index = FT_Get_Char_Index(src.freetype.face, glyph.glyph.codepoint);
+				if (!glyph.glyph_index) {
 					return;
 				}
-				if (auto result = FT_Load_Glyph(src.freetype.face, glyph_index, src.freetype.flags); result) {
-					return;
-				}
-
-				if (src.freetype.rasterizer_flags & rasterizer_flags::bold)
-					FT_GlyphSlot_Embolden(src.freetype.face->glyph);
 
-				if (src.freetype.rasterizer_flags & rasterizer_flags::oblique)
-					FT_GlyphSlot_Oblique(src.freetype.face->glyph);
-
-				if (auto result = FT_Render_Glyph(src.freetype.face->glyph, src.freetype.render_mode); result) {
+				FT_Pos hinted_advance_x{};
+				if (!load_glyph(src, glyph, &hinted_advance_x)) {
 					return;
-                }
-
-				glyph.glyph.corners.x = src.freetype.face->glyph->bitmap.width;
-				glyph.glyph.corners.y = src.freetype.face->glyph->bitmap.rows;
-				glyph.glyph.texture_coordinates.x = src.freetype.face->glyph->bitmap_left;
-				glyph.glyph.texture_coordinates.y = -src.freetype.face->glyph->bitmap_top;
-				glyph.glyph.advance_x = std::ceilf(std::floorf(src.freetype.face->glyph->advance.x) / 64.f);
+				}
 
-				const FT_Bitmap* ft_bitmap = &src.freetype.face->glyph->bitmap;
-				if (!ft_bitmap) {
-					return;
+				const FT_GlyphSlot slot = src.freetype.face->glyph;
+				if (slot->format == FT_GLYPH_FORMAT_OUTLINE) {
+					FT_BBox box{};
+					FT_Outline_Get_CBox(&slot->outline, &box);
+					box.xMin &= -64;
+					box.yMin &= -64;
+					box.xMax = (box.xMax + 63) & -64;
+					box.yMax = (box.yMax + 63) & -64;
+
+					glyph.glyph.corners.x = (float)((box.xMax - box.xMin) >> 6);
+					glyph.glyph.corners.y = (float)((box.yMax - box.yMin) >> 6);
+					glyph.glyph.texture_coordinates.x = (float)(box.xMin >> 6);
+					glyph.glyph.texture_coordinates.y = (float)-(box.yMax >> 6);
+				}
+				else {
+					// Other formats only know their size once rendered
+					if (auto result = FT_Render_Glyph(slot, src.freetype.render_mode); result) {
+						return;
+					}
+
+					glyph.glyph.corners.x = (float)slot->bitmap.width;
+					glyph.glyph.corners.y = (float)slot->bitmap.rows;
+					glyph.glyph.texture_coordinates.x = (float)slot->bitmap_left;
+					glyph.glyph.texture_coordinates.y = (float)-slot->bitmap_top;
 				}
 
-				glyph.bitmap.resize(ft_bitmap->width * (ft_bitmap->rows * ft_bitmap->pitch));
-				switch (ft_bitmap->pixel_mode) {
-					case FT_PIXEL_MODE_GRAY:
-						{
-							for (std::uint32_t y : std::views::iota(0u, ft_bitmap->rows)) {
-								for (std::uint32_t x : std::views::iota(0u, ft_bitmap->width)) {
-									glyph.bitmap[y * (int)glyph.glyph.corners.x + x] =
-									ft_bitmap->buffer[y * ft_bitmap->pitch + x];
-								}
-							}
-						}
-						break;
-
-					case FT_PIXEL_MODE_MONO:
-						{
-							for (std::uint32_t y : std::views::iota(0u, ft_bitmap->rows)) {
-								std::uint8_t bits{};
-								const std::uint8_t* bits_ptr = ft_bitmap->buffer + y * ft_bitmap->pitch;
-								for (uint32_t x = 0; x < ft_bitmap->width; x++, bits <<= 1) {
-									if (!(x & 7))
-										bits = *bits_ptr++;
-									glyph.bitmap[y * (int)glyph.glyph.corners.x + x] = (bits & 0x80) ? 255 : 0;
-								}
-							}
-						}
-						break;
+				glyph.glyph.advance_x = std::ceilf(std::floorf(slot->advance.x) / 64.f);
 
-					default:
-						// TODO: Assertion
-						break;
-				}
+				// Hinting rounds the advance to whole pixels, positioning by subpixel needs the unrounded one
+				if (src.subpixel_phases > 1)
+					glyph.glyph.advance_x =
+					(float)slot->linearHoriAdvance / 65536.f + (float)(slot->advance.x - hinted_advance_x) / 64.f;
 
 				src.rects[i].w = (stbrp_coord)(glyph.glyph.corners.x + texture.glyph_padding);
 				src.rects[i].h = (stbrp_coord)(glyph.glyph.corners.y + texture.glyph_padding);
@@ -388,32 +633,156 @@ namespace renderer {
 			}
 		}
 
-		int surface_sqrt = std::sqrtf(total_surface) + 1;
-		texture.size = glm::vec2((surface_sqrt >= 4096 * 0.7f)	   ? 4096
-								 : (surface_sqrt >= 2048 * 0.7f)   ? 2048
-								   : (surface_sqrt >= 1024 * 0.7f) ? 1024
-																   : 512,
-								 0);
+		// Reloads a glyph and renders it into its packed spot, the page is zeroed and padding keeps glyphs apart so
+		// outlines can be rasterized in place
+		const auto render_glyph = [&](build_src& src, const src_glyph& glyph, font_page& page, int x, int y) {
+			const auto width = (uint32_t)glyph.glyph.corners.x, rows = (uint32_t)glyph.glyph.corners.y;
+			if (!width || !rows)
+				return true;
+
+			if (!load_glyph(src, glyph))
+				return false;
+
+			const FT_GlyphSlot slot = src.freetype.face->glyph;
+			const auto pitch = (size_t)page.size.x;
+			uint8_t* dst = page.pixels_alpha8.data() + (size_t)y * pitch + (size_t)x;
+			if (slot->format == FT_GLYPH_FORMAT_OUTLINE) {
+				FT_Bitmap bitmap{};
+				bitmap.width = width;
+				bitmap.rows = rows;
+				bitmap.pitch = (int)pitch;
+				bitmap.buffer = dst;
+				bitmap.num_grays = 256;
+				bitmap.pixel_mode = FT_PIXEL_MODE_GRAY;
+
+				// Move the bottom left of the measured box to the origin of the target
+				FT_Outline_Translate(&slot->outline, -(FT_Pos)glyph.glyph.texture_coordinates.x * 64,
+									 ((FT_Pos)glyph.glyph.texture_coordinates.y + (FT_Pos)rows) * 64);
+				return FT_Outline_Get_Bitmap(ft_library, &slot->outline, &bitmap) == 0;
+			}
 
-		std::vector<stbrp_node> pack_nodes((size_t)texture.size.x - texture.glyph_padding);
-		stbrp_context pack_context{};
-		stbrp_init_target(&pack_context, texture.size.x, 1024 * 32, pack_nodes.data(), pack_nodes.size());
-		pack_custom_rects(&pack_context);
+			if (auto result = FT_Render_Glyph(slot, src.freetype.render_mode); result)
+				return false;
+
+			const FT_Bitmap& ft_bitmap = slot->bitmap;
+			const uint32_t copy_width = std::min(width, ft_bitmap.width), copy_rows = std::min(rows, ft_bitmap.rows);
+			switch (ft_bitmap.pixel_mode) {
+				case FT_PIXEL_MODE_GRAY:
+					{
+						for (uint32_t row : std::views::iota(0u, copy_rows))
+							memcpy(dst + row * pitch, ft_bitmap.buffer + row * ft_bitmap.pitch, copy_width);
+					}
+					break;
+
+				case FT_PIXEL_MODE_MONO:
+					{
+						for (uint32_t row : std::views::iota(0u, copy_rows)) {
+							uint8_t bits{};
+							const uint8_t* bits_ptr = ft_bitmap.buffer + row * ft_bitmap.pitch;
+							for (uint32_t column = 0; column < copy_width; column++, bits <<= 1) {
+								if (!(column & 7))
+									bits = *bits_ptr++;
+								dst[row * pitch + column] = (bits & 0x80) ? 255 : 0;
+							}
+						}
+					}
+					break;
 
-		for (build_src& src : src_array) {
-			if (!src.glyphs_count)
-				continue;
+				default:
+					// TODO: Assertion
+					break;
+			}
 
-			stbrp_pack_rects(&pack_context, src.rects, src.glyphs_count);
+			return true;
+		};
 
-			for (int i : std::views::iota(0, src.glyphs_count)) {
-				if (src.rects[i].was_packed)
-					texture.size.y = std::max((int)texture.size.y, src.rects[i].y + src.rects[i].h);
+		const int page_limit = std::max(texture.max_page_size, 128);
+		int surface_sqrt = std::sqrtf(total_surface) + 1;
+		int page_width = (surface_sqrt >= 4096 * 0.7f)	 ? 4096
+						 : (surface_sqrt >= 2048 * 0.7f) ? 2048
+						 : (surface_sqrt >= 1024 * 0.7f) ? 1024
+														 : 512;
+		if (texture.desired_width > 0)
+			page_width = texture.desired_width;
+		page_width = std::min(page_width, page_limit);
+
+		// Glyphs are packed page by page, anything that doesn't fit is carried over to a new page. The id is the index
+		// into buf_rects so results can be written back after stb reorders them
+		std::vector<uint32_t> rect_pages(buf_rects.size(), 0);
+		std::vector<stbrp_rect> pending_rects;
+		pending_rects.reserve(buf_rects.size());
+		stats = atlas_stats{};
+		for (int i : std::views::iota(0, (int)buf_rects.size())) {
+			stbrp_rect& rect = buf_rects[i];
+			rect.was_packed = 0;
+			if (rect.w > page_width || rect.h > page_limit) {
+				DPRINTF("[!] Glyph of %dx%d doesn't fit on a %dx%d atlas page\n", rect.w, rect.h, page_width, page_limit);
+				stats.glyphs_dropped++;
+				continue;
 			}
+
+			rect.id = i;
+			pending_rects.push_back(rect);
 		}
 
-		texture.size.y = std::powf(2.f, std::ceilf(std::logf(texture.size.y) / std::logf(2.f)));
-		texture.pixels_alpha8.resize(texture.size.x * texture.size.y);
+		const auto pack_start = std::chrono::steady_clock::now();
+		const std::unique_ptr<rect_packer> packer = rect_packer::create(texture.packer);
+		do {
+			const auto page_index = (uint32_t)texture.pages.size();
+			font_page& page = texture.pages.emplace_back();
+			page.size = glm::vec2(page_width, 0.f);
+
+			packer->init(page_width, page_limit);
+			if (page_index == 0)
+				pack_custom_rects(packer.get(), page);
+
+			packer->pack(pending_rects.data(), (int)pending_rects.size());
+
+			const auto unpacked =
+			std::ranges::partition(pending_rects, [](const stbrp_rect& rect) { return rect.was_packed != 0; });
+			for (const stbrp_rect& rect : std::ranges::subrange(pending_rects.begin(), unpacked.begin())) {
+				buf_rects[rect.id] = rect;
+				rect_pages[rect.id] = page_index;
+				page.size.y = std::max(page.size.y, (float)(rect.y + rect.h));
+				stats.used_area += (uint64_t)rect.w * rect.h;
+				stats.glyphs_packed++;
+			}
+
+			// Every rect fits an empty page so this can only happen on a page that already holds the custom rects
+			const bool stalled = unpacked.begin() == pending_rects.begin() && page_index != 0;
+			pending_rects.erase(pending_rects.begin(), unpacked.begin());
+
+			page.size.y = std::max(page.size.y, 1.f);
+			if (!texture.tight_pages)
+				page.size.y = std::min(std::powf(2.f, std::ceilf(std::log2f(page.size.y))), (float)page_limit);
+			page.pixels_alpha8.resize(page.size.x * page.size.y);
+			stats.total_area += (uint64_t)page.size.x * (uint64_t)page.size.y;
+
+			if (stalled)
+				break;
+		} while (!pending_rects.empty());
+
+		stats.glyphs_dropped += pending_rects.size();
+		stats.pages = texture.pages.size();
+		stats.pack_time_ms =
+		std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - pack_start).count();
+
+		// Rasterizing is the slow part of the build, every source has its own face so sources render in parallel. Packed
+		// rects never overlap so they can share pages
+		job_system::get_default().parallel_for(0, src_array.size(), 1, [&](size_t first, size_t last) {
+			for (build_src& src : std::span(src_array).subspan(first, last - first)) {
+				for (int i : std::views::iota(0, src.glyphs_count)) {
+					const stbrp_rect& pack_rect = src.rects[i];
+					if (!pack_rect.was_packed || (!pack_rect.w && !pack_rect.h))
+						continue;
+
+					const src_glyph& glyph = src.glyphs_list[i];
+					font_page& page = texture.pages[rect_pages[std::distance(buf_rects.data(), &pack_rect)]];
+					if (!render_glyph(src, glyph, page, pack_rect.x, pack_rect.y))
+						DPRINTF("[!] Failed to render glyph U+%04X\n", glyph.glyph.codepoint);
+				}
+			}
+		});
 
 		for (auto [src, config] : std::views::zip(src_array, configs)) {
 			if (!src.glyphs_count)
@@ -423,13 +792,22 @@ namespace renderer {
 
 			setup_font(dst_font, &config, src.freetype.info.ascender, src.freetype.info.descender);
 
+			// Phase 0 of the glyph the following variants belong to
+			size_t main_glyph_index = std::numeric_limits<size_t>::max();
+			float main_shift_x = 0.0f;
+
 			for (int i : std::views::iota(0, src.glyphs_count)) {
 				src_glyph& glyph = src.glyphs_list[i];
 				stbrp_rect& pack_rect = src.rects[i];
 				if (!pack_rect.was_packed) {
+					if (!glyph.phase)
+						main_glyph_index = std::numeric_limits<size_t>::max();
 					continue;
 				}
 
+				const uint32_t page_index = rect_pages[std::distance(buf_rects.data(), &pack_rect)];
+				font_page& page = texture.pages[page_index];
+
 				if (!pack_rect.w && !pack_rect.h)
 					continue;
 
@@ -441,22 +819,34 @@ namespace renderer {
 				}
 
 				glm::vec2 t(pack_rect.x, pack_rect.y);
-				for (int y : std::views::iota(0, glyph.glyph.corners.y)) {
-					std::copy(
-					std::next(glyph.bitmap.begin(), glyph.glyph.corners.x * y),
-					std::next(glyph.bitmap.begin(), glyph.glyph.corners.x * (y + 1)),
-					std::next(texture.pixels_alpha8.begin(), (t.y * texture.size.x) + t.x + (texture.size.x * y)));
-				}
 
 				auto temp = glm::vec2(glyph.glyph.texture_coordinates.x, glyph.glyph.texture_coordinates.y) +
 							config.glyph_config.offset + glm::vec2(0.f, round(dst_font->ascent));
 
-				dst_font->add_glyph(&config, (std::uint16_t)glyph.glyph.codepoint,
-									glm::vec4(temp.x, temp.y, temp.x, temp.y) +
-									glm::vec4(0.f, 0.f, glyph.glyph.corners.x, glyph.glyph.corners.y),
-									glm::vec4(t.x, t.y, t.x + glyph.glyph.corners.x, t.y + glyph.glyph.corners.y) /
-									glm::vec4(texture.size.x, texture.size.y, texture.size.x, texture.size.y),
-									glyph.glyph.advance_x);
+				const glm::vec4 corners = glm::vec4(temp.x, temp.y, temp.x, temp.y) +
+										  glm::vec4(0.f, 0.f, glyph.glyph.corners.x, glyph.glyph.corners.y);
+				const glm::vec4 texture_coordinates =
+				glm::vec4(t.x, t.y, t.x + glyph.glyph.corners.x, t.y + glyph.glyph.corners.y) /
+				glm::vec4(page.size.x, page.size.y, page.size.x, page.size.y);
+
+				if (glyph.phase) {
+					if (main_glyph_index >= dst_font->glyphs.size() ||
+						dst_font->glyphs[main_glyph_index].codepoint != glyph.glyph.codepoint)
+						continue;
+
+					text_font::glyph& main_glyph = dst_font->glyphs[main_glyph_index];
+					text_font::glyph& variant_glyph = dst_font->glyphs[main_glyph.subpixel_offset + glyph.phase - 1];
+					variant_glyph.corners = corners + glm::vec4(main_shift_x, 0.f, 0.f, 0.f);
+					variant_glyph.texture_coordinates = texture_coordinates;
+					variant_glyph.page = page_index;
+					continue;
+				}
+
+				dst_font->add_glyph(&config, glyph.glyph.codepoint, corners, texture_coordinates, glyph.glyph.advance_x,
+									page_index, src.subpixel_phases);
+
+				main_glyph_index = dst_font->glyphs.size() - src.subpixel_phases;
+				main_shift_x = dst_font->glyphs[main_glyph_index].corners.x - corners.x;
 			}
 		}
 
@@ -472,9 +862,12 @@ namespace renderer {
 		if (auto result = FT_Done_FreeType(ft_library); result) {
 			// TODO: Assert
 		}
+
+		if (!cache_filename.empty())
+			save_cache(cache_filename);
 	}
 
-	void font_atlas::pack_custom_rects(stbrp_context* context) {
+	void font_atlas::pack_custom_rects(rect_packer* packer, font_page& page) {
 		render_vector<stbrp_rect> pack_rects;
 		pack_rects.resize(custom_rects.Size);
 		memset(pack_rects.Data, 0, (size_t)pack_rects.size_in_bytes());
@@ -482,18 +875,346 @@ namespace renderer {
 			pack_rects[i].w = custom_rects[i].size.x;
 			pack_rects[i].h = custom_rects[i].size.y;
 		}
-		stbrp_pack_rects(context, &pack_rects[0], pack_rects.Size);
+		packer->pack(&pack_rects[0], pack_rects.Size);
 		for (size_t i = 0; i < pack_rects.Size; i++) {
 			if (pack_rects[i].was_packed) {
+				stats.used_area += (uint64_t)pack_rects[i].w * pack_rects[i].h;
 				custom_rects[i].size.x = pack_rects[i].x;
 				custom_rects[i].size.y = pack_rects[i].y;
 				custom_rects[i].size.z = pack_rects[i].w;
 				custom_rects[i].size.w = pack_rects[i].h;
-				texture.size.y = std::max(texture.size.y, (float)(pack_rects[i].y + pack_rects[i].h));
+				page.size.y = std::max(page.size.y, (float)(pack_rects[i].y + pack_rects[i].h));
 			}
 		}
 	}
 
+	const text_font* font_atlas::snapshot::get_font(const text_font* font) const {
+		for (size_t i = 0; i < fonts.size(); i++) {
+			if (sources[i] == font || fonts[i].get() == font)
+				return fonts[i].get();
+		}
+
+		return nullptr;
+	}
+
+	void font_atlas::publish_snapshot() {
+		publish_snapshot(nullptr, nullptr);
+	}
+
+	void font_atlas::publish_snapshot(const snapshot* previous, const text_font* edited) {
+		auto next = std::make_shared<snapshot>();
+		next->version = ++snapshot_version_;
+		next->tex_uv_white_pixel = tex_uv_white_pixel;
+		std::ranges::copy(tex_uv_lines, next->tex_uv_lines.begin());
+
+		next->pages.reserve(texture.pages.size());
+		for (const font_page& page : texture.pages)
+			next->pages.emplace_back(page.data);
+
+		next->sources.reserve(fonts.size());
+		next->fonts.reserve(fonts.size());
+		for (const std::unique_ptr<text_font>& font : fonts) {
+			next->sources.push_back(font.get());
+
+			if (previous && font.get() != edited) {
+				if (const auto iterator = std::ranges::find(previous->sources, font.get());
+					iterator != previous->sources.end()) {
+					next->fonts.push_back(previous->fonts[std::distance(previous->sources.begin(), iterator)]);
+					continue;
+				}
+			}
+
+			auto copy = std::make_shared<text_font>(*font);
+
+			// The fallback glyph points into the live font's glyphs
+			if (font->fallback_glyph)
+				copy->fallback_glyph = &copy->glyphs[std::distance(font->glyphs.data(), font->fallback_glyph)];
+
+			next->fonts.push_back(std::move(copy));
+		}
+
+		current_snapshot_.store(std::move(next), std::memory_order_release);
+	}
+
+	void font_atlas::republish_snapshot(const text_font* font) {
+		const std::shared_ptr<const snapshot> previous = acquire_snapshot();
+		if (!previous || !texture.is_built() ||
+			std::ranges::any_of(texture.pages, [](const font_page& page) { return !page.data; })) {
+			return;
+		}
+
+		publish_snapshot(previous.get(), font);
+	}
+
+	uint64_t font_atlas::get_cache_key() const {
+		uint64_t hash = hash_value(hash_seed, cache_version);
+		hash = hash_value(hash, texture.glyph_padding);
+		hash = hash_value(hash, texture.desired_width);
+		hash = hash_value(hash, texture.max_page_size);
+		hash = hash_value(hash, texture.tight_pages);
+		hash = hash_value(hash, texture.packer);
+		hash = hash_value(hash, fonts.size());
+
+		// Merged fallback glyphs are part of the cached tables
+		for (const std::unique_ptr<text_font>& font : fonts) {
+			for (const text_font* fallback_font : font->fallback_fonts) {
+				const auto font_iterator = std::ranges::find_if(
+				fonts, [&](const std::unique_ptr<text_font>& other) { return other.get() == fallback_font; });
+
+				hash = hash_value(hash, std::distance(fonts.begin(), font_iterator));
+			}
+
+			hash = hash_value(hash, font->fallback_fonts.size());
+
+			// Advances of missing glyphs are baked from the fallback glyph
+			hash = hash_value(hash, font->fallback_char);
+		}
+
+		for (const text_font::font_config& config : configs) {
+			const auto font_iterator = std::ranges::find_if(
+			fonts, [&](const std::unique_ptr<text_font>& font) { return font.get() == config.font; });
+
+			hash = hash_value(hash, std::distance(fonts.begin(), font_iterator));
+			hash = hash_value(hash, config.data->get_identity());
+
+			hash = hash_value(hash, config.index);
+			hash = hash_value(hash, config.size_pixels);
+			hash = hash_value(hash, config.oversample);
+			hash = hash_value(hash, config.subpixel_phases);
+			hash = hash_value(hash, config.pixel_snap_h);
+			hash = hash_value(hash, config.rasterizer_flags);
+			hash = hash_value(hash, config.glyph_config.offset);
+			hash = hash_value(hash, config.glyph_config.extra_spacing);
+			hash = hash_value(hash, config.glyph_config.min_advance_x);
+			hash = hash_value(hash, config.glyph_config.max_advance_x);
+
+			const uint32_t* ranges =
+			config.glyph_config.ranges ? config.glyph_config.ranges : text_font::glyph::ranges_default();
+			for (; ranges[0] && ranges[1]; ranges += 2)
+				hash = hash_bytes(hash, ranges, sizeof(uint32_t) * 2);
+		}
+
+		return hash;
+	}
+
+	bool font_atlas::load_cache(std::string_view filename) {
+		if (locked) {
+			return false;
+		}
+
+		const mapped_file file(filename);
+		if (!file.is_open()) {
+			return false;
+		}
+
+		cache_reader reader{ file.data(), file.data() + file.size() };
+
+		cache_header header{};
+		if (!reader.read(header) || header.magic != cache_magic || header.version != cache_version) {
+			return false;
+		}
+
+		if (header.key != get_cache_key() || header.font_count != fonts.size()) {
+			return false;
+		}
+
+		// Everything is validated before any font is touched so a stale or truncated cache leaves the atlas as it was
+		std::vector<cache_font> font_headers(header.font_count);
+		std::vector<const uint8_t*> font_data(header.font_count);
+		for (auto&& [font_header, data] : std::views::zip(font_headers, font_data)) {
+			if (!reader.read(font_header)) {
+				return false;
+			}
+
+			if (font_header.config_index < 0 || font_header.config_index >= (int32_t)configs.size()) {
+				return false;
+			}
+
+			data = reader.ptr;
+			if (font_header.lookup_slot_count < text_font::font_lookup_table::page_size ||
+				font_header.lookup_slot_count % text_font::font_lookup_table::page_size) {
+				return false;
+			}
+
+			const size_t size = font_header.glyph_count * sizeof(text_font::glyph) +
+								font_header.lookup_page_count * sizeof(uint16_t) +
+								font_header.lookup_slot_count * (sizeof(float) + sizeof(uint32_t));
+			if ((size_t)(reader.end - reader.ptr) < size) {
+				return false;
+			}
+
+			// Page indexes come straight from disk, make sure they stay inside the slot arrays
+			const uint32_t page_count = font_header.lookup_slot_count / text_font::font_lookup_table::page_size;
+			std::vector<uint16_t> pages(font_header.lookup_page_count);
+			memcpy(pages.data(), reader.ptr + font_header.glyph_count * sizeof(text_font::glyph),
+				   pages.size() * sizeof(uint16_t));
+			if (std::ranges::any_of(pages, [=](uint16_t page) { return page >= page_count; })) {
+				return false;
+			}
+
+			// Same for glyph indexes and the subpixel variants each glyph points at
+			const uint8_t* glyphs_data = reader.ptr;
+			for (uint32_t i = 0; i < font_header.glyph_count; i++) {
+				text_font::glyph glyph;
+				memcpy(&glyph, glyphs_data + i * sizeof(text_font::glyph), sizeof(glyph));
+				if (glyph.subpixel_phases > 1 &&
+					(uint64_t)glyph.subpixel_offset + glyph.subpixel_phases - 1 > font_header.glyph_count) {
+					return false;
+				}
+			}
+
+			const uint8_t* indexes_data = reader.ptr + font_header.glyph_count * sizeof(text_font::glyph) +
+										  font_header.lookup_page_count * sizeof(uint16_t) +
+										  font_header.lookup_slot_count * sizeof(float);
+			for (uint32_t i = 0; i < font_header.lookup_slot_count; i++) {
+				uint32_t index;
+				memcpy(&index, indexes_data + i * sizeof(uint32_t), sizeof(index));
+				if (index != text_font::font_lookup_table::empty_index && index >= font_header.glyph_count) {
+					return false;
+				}
+			}
+
+			reader.ptr += size;
+		}
+
+		std::vector<cache_custom_rect> rects(header.custom_rect_count);
+		if (!reader.read_array(rects.data(), rects.size())) {
+			return false;
+		}
+
+		if (!header.page_count) {
+			return false;
+		}
+
+		std::vector<cache_page> page_headers(header.page_count);
+		std::vector<const uint8_t*> page_pixels(header.page_count);
+		for (auto&& [page_header, pixels] : std::views::zip(page_headers, page_pixels)) {
+			if (!reader.read(page_header) ||
+				page_header.pixels_size != (uint64_t)(page_header.size.x * page_header.size.y) ||
+				(uint64_t)(reader.end - reader.ptr) < page_header.pixels_size) {
+				return false;
+			}
+
+			pixels = reader.ptr;
+			reader.ptr += page_header.pixels_size;
+		}
+
+		texture.clear();
+		for (auto&& [page_header, pixels] : std::views::zip(page_headers, page_pixels)) {
+			font_page& page = texture.pages.emplace_back();
+			page.size = page_header.size;
+			page.pixels_alpha8.assign(pixels, pixels + page_header.pixels_size);
+		}
+
+		custom_rects.clear();
+		for (const cache_custom_rect& rect : rects) {
+			custom_rects.push_back(custom_rect{ .size{ rect.size },
+												.glyph_id{ rect.glyph_id },
+												.glyph_advance_x{ rect.glyph_advance_x },
+												.glyph_offset{ rect.glyph_offset },
+												.font{ rect.font_index >= 0 && rect.font_index < (int32_t)fonts.size()
+													   ? fonts[rect.font_index].get()
+													   : nullptr } });
+		}
+
+		white_pixel_id = header.white_pixel_id;
+		lines_id = header.lines_id;
+		tex_uv_white_pixel = header.tex_uv_white_pixel;
+		std::ranges::copy(header.tex_uv_lines, tex_uv_lines);
+
+		for (auto&& [font, font_header, data] : std::views::zip(fonts, font_headers, font_data)) {
+			cache_reader font_reader{ data, reader.end };
+
+			text_font::font_config& config = configs[font_header.config_index];
+			setup_font(font.get(), &config, font_header.ascent, font_header.descent);
+			font->size = font_header.size;
+
+			// One allocation per array, the glyphs are copied straight out of the mapping
+			font->glyphs.resize(font_header.glyph_count);
+			font->merged_glyphs_offset = std::min(font_header.merged_glyphs_offset, font_header.glyph_count);
+			text_font::font_lookup_table& lookup_table = font->lookup_table;
+			lookup_table.pages.resize(font_header.lookup_page_count);
+			lookup_table.advances_x.resize(font_header.lookup_slot_count);
+			lookup_table.indexes.resize(font_header.lookup_slot_count);
+			lookup_table.dirty = false;
+			font_reader.read_array(font->glyphs.data(), font->glyphs.size());
+			font_reader.read_array(lookup_table.pages.data(), lookup_table.pages.size());
+			font_reader.read_array(lookup_table.advances_x.data(), lookup_table.advances_x.size());
+			font_reader.read_array(lookup_table.indexes.data(), lookup_table.indexes.size());
+
+			font->fallback_glyph = font->find_glyph(font->fallback_char, false);
+			font->fallback_advance_x = font->fallback_glyph ? font->fallback_glyph->advance_x : 0.0f;
+		}
+
+		stats = atlas_stats{};
+		return true;
+	}
+
+	bool font_atlas::save_cache(std::string_view filename) const {
+		if (!texture.is_built()) {
+			return false;
+		}
+
+		std::ofstream file(std::string(filename), std::ios::out | std::ios::binary | std::ios::trunc);
+		if (!file.is_open()) {
+			return false;
+		}
+
+		cache_header header{};
+		header.key = get_cache_key();
+		header.font_count = (uint32_t)fonts.size();
+		header.custom_rect_count = (uint32_t)custom_rects.size();
+		header.white_pixel_id = (uint32_t)white_pixel_id;
+		header.lines_id = (uint32_t)lines_id;
+		header.page_count = (uint32_t)texture.pages.size();
+		header.tex_uv_white_pixel = tex_uv_white_pixel;
+		std::ranges::copy(tex_uv_lines, header.tex_uv_lines);
+		write_value(file, header);
+
+		for (const std::unique_ptr<text_font>& font : fonts) {
+			const auto config_iterator = std::ranges::find_if(
+			configs, [&](const text_font::font_config& config) { return config.font == font.get(); });
+
+			cache_font font_header{};
+			font_header.config_index =
+			config_iterator != configs.end() ? (int32_t)std::distance(configs.begin(), config_iterator) : -1;
+			font_header.fallback_char = font->fallback_char;
+			font_header.size = font->size;
+			font_header.ascent = font->ascent;
+			font_header.descent = font->descent;
+			font_header.glyph_count = (uint32_t)font->glyphs.size();
+			font_header.merged_glyphs_offset = (uint32_t)font->merged_glyphs_offset;
+			font_header.lookup_page_count = (uint32_t)font->lookup_table.pages.size();
+			font_header.lookup_slot_count = (uint32_t)font->lookup_table.indexes.size();
+			write_value(file, font_header);
+
+			write_array(file, font->glyphs.data(), font->glyphs.size());
+			write_array(file, font->lookup_table.pages.data(), font->lookup_table.pages.size());
+			write_array(file, font->lookup_table.advances_x.data(), font->lookup_table.advances_x.size());
+			write_array(file, font->lookup_table.indexes.data(), font->lookup_table.indexes.size());
+		}
+
+		for (const custom_rect& rect : custom_rects) {
+			const auto font_iterator = std::ranges::find_if(
+			fonts, [&](const std::unique_ptr<text_font>& font) { return font.get() == rect.font; });
+
+			write_value(file, cache_custom_rect{ .size{ rect.size },
+												 .glyph_id{ rect.glyph_id },
+												 .glyph_advance_x{ rect.glyph_advance_x },
+												 .glyph_offset{ rect.glyph_offset },
+												 .font_index{ font_iterator != fonts.end()
+															  ? (int32_t)std::distance(fonts.begin(), font_iterator)
+															  : -1 } });
+		}
+
+		for (const font_page& page : texture.pages) {
+			write_value(file, cache_page{ .size{ page.size }, .pixels_size{ page.pixels_alpha8.size() } });
+			write_array(file, page.pixels_alpha8.data(), page.pixels_alpha8.size());
+		}
+
+		return file.good();
+	}
+
 	text_font* font_atlas::add_font(const text_font::font_config* config) {
 		if (locked) {
 			return nullptr;
@@ -503,7 +1224,7 @@ namespace renderer {
 			return nullptr;
 		}
 
-		if (config->data.empty()) {
+		if (!config->data || config->data->empty()) {
 			return nullptr;
 		}
 
@@ -519,9 +1240,6 @@ namespace renderer {
 		if (!cfg.font)
 			cfg.font = fonts.back().get();
 
-		if (cfg.data.empty())
-			cfg.data = config->data;
-
 		texture.clear();
 		return cfg.font;
 	}
@@ -543,6 +1261,24 @@ namespace renderer {
 		cfg.glyph_config.ranges ? cfg.glyph_config.ranges : text_font::glyph::ranges_default());
 	}
 
+	std::shared_ptr<const font_blob> font_atlas::get_file_blob(std::string_view filename) {
+		const std::string key(filename);
+		if (const auto iterator = file_blobs.find(key); iterator != file_blobs.end()) {
+			if (std::shared_ptr<const font_blob> blob = iterator->second.lock())
+				return blob;
+		}
+
+		mapped_file file(filename);
+		if (!file.is_open()) {
+			DPRINTF("[!] Failed to map font file %s\n", key.c_str());
+			return nullptr;
+		}
+
+		std::shared_ptr<const font_blob> blob = std::make_shared<const font_blob>(std::move(file), filename);
+		file_blobs[key] = blob;
+		return blob;
+	}
+
 	text_font* font_atlas::add_font_from_file_ttf(const std::string_view filename,
 												  const float size_pixels,
 												  text_font::font_config* config,
@@ -551,20 +1287,15 @@ namespace renderer {
 			return nullptr;
 		}
 
-		std::ifstream file(filename.data(), std::ios::in | std::ios::binary | std::ios::ate);
-		if (!file.is_open()) {
+		std::shared_ptr<const font_blob> blob = get_file_blob(filename);
+		if (!blob) {
 			return nullptr;
 		}
 
-		std::vector<char> font_file(file.tellg());
-		file.seekg(0, std::ios::beg);
-		file.read(font_file.data(), font_file.size());
-		file.close();
-
-		return add_font_from_memory_ttf(font_file, size_pixels, config, glyph_ranges);
+		return add_font_from_blob(std::move(blob), size_pixels, config, glyph_ranges);
 	}
 
-	text_font* font_atlas::add_font_from_memory_ttf(const std::vector<char>& font_file,
+	text_font* font_atlas::add_font_from_memory_ttf(std::vector<char> font_file,
 													float size_pixels,
 													text_font::font_config* config,
 													const uint32_t* glyph_ranges) {
@@ -572,12 +1303,20 @@ namespace renderer {
 			return nullptr;
 		}
 
-		text_font::font_config cfg = config ? *config : text_font::font_config{};
-		if (!cfg.data.empty()) {
-			// TODO: Throw some assertion
+		return add_font_from_blob(std::make_shared<const font_blob>(std::move(font_file)), size_pixels, config,
+								  glyph_ranges);
+	}
+
+	text_font* font_atlas::add_font_from_blob(std::shared_ptr<const font_blob> blob,
+											  float size_pixels,
+											  text_font::font_config* config,
+											  const uint32_t* glyph_ranges) {
+		if (locked) {
+			return nullptr;
 		}
 
-		cfg.data = font_file;
+		text_font::font_config cfg = config ? *config : text_font::font_config{};
+		cfg.data = std::move(blob);
 		cfg.size_pixels = size_pixels;
 		if (glyph_ranges)
 			cfg.glyph_config.ranges = glyph_ranges;
@@ -585,21 +1324,25 @@ namespace renderer {
 		return add_font(&cfg);
 	}
 
-	text_font* font_atlas::add_font_from_memory_compressed_ttf(const std::vector<uint8_t>& compressed_ttf,
+	text_font* font_atlas::add_font_from_memory_compressed_ttf(std::span<const uint8_t> compressed_ttf,
 															   float size_pixels,
 															   text_font::font_config* config,
 															   const uint32_t* glyph_ranges) {
-		// std::vector<char> buf_decompressed_data(stb::decompress_length((uint8_t*)compressed_ttf.data()));
-		// stb::decompress((uint8_t*)buf_decompressed_data.data(), compressed_ttf.data());
-		//
-		// text_font::font_config cfg = config ? *config : text_font::font_config{};
-		// if (!cfg.data.empty()) {
-		// 	// TODO: Throw some assertion here
-		// }
-		//
-		// return add_font_from_memory_ttf(buf_decompressed_data, size_pixels, &cfg, glyph_ranges);
+		if (locked) {
+			return nullptr;
+		}
 
-		return nullptr;
+		// Accepts both stb_compress streams and the LZ4 container written by binary_to_compressed
+		std::vector<char> font_file;
+		if (!decompress_binary(compressed_ttf, font_file)) {
+			DPRINTF("[!] Failed to decompress a compressed font of %zu bytes\n", compressed_ttf.size());
+			return nullptr;
+		}
+
+		// The compressed stream is smaller than the font, hashing it instead still changes with the data
+		const uint64_t identity = hash_bytes(hash_seed, compressed_ttf.data(), compressed_ttf.size());
+		return add_font_from_blob(std::make_shared<const font_blob>(std::move(font_file), identity), size_pixels, config,
+								  glyph_ranges);
 	}
 
 	void font_atlas::clear_input_data() {
@@ -612,6 +1355,7 @@ namespace renderer {
 		}
 
 		configs.clear();
+		std::erase_if(file_blobs, [](const auto& entry) { return entry.second.expired(); });
 	}
 
 	text_font* get_default_font() {
@@ -16,6 +16,7 @@ renderer::d3d11_renderer::d3d11_renderer(std::shared_ptr<win32_window> window) :
 	context_->device_resources_ = std::make_unique<device_resources>();
 	context_->device_resources_->set_window(window);
 	context_->device_resources_->register_device_notify(this);
+	publish_draw_order();
 }
 
 renderer::d3d11_renderer::d3d11_renderer(IDXGISwapChain* swap_chain) : msaa_enabled_(false), target_sample_count_(8) {
@@ -25,6 +26,7 @@ renderer::d3d11_renderer::d3d11_renderer(IDXGISwapChain* swap_chain) : msaa_enab
 	context_->device_resources_ = std::make_unique<device_resources>();
 	context_->device_resources_->set_swap_chain(swap_chain);
 	context_->device_resources_->register_device_notify(this);
+	publish_draw_order();
 }
 
 bool renderer::d3d11_renderer::initialize() {
@@ -42,27 +44,117 @@ bool renderer::d3d11_renderer::release() {
 	return true;
 }
 
+size_t renderer::d3d11_renderer::create_node(size_t vertices_reserve_size,
+											size_t indices_reserve_size,
+											size_t batches_reserve_size) {
+	const auto reusable = std::find_if(free_buffers_.begin(), free_buffers_.end(), [](const free_node& free) {
+		return std::ranges::all_of(free.orders, [](const auto& order) { return order.expired(); });
+	});
+
+	size_t index;
+	if (reusable != free_buffers_.end()) {
+		index = reusable->index;
+		free_buffers_.erase(reusable);
+	}
+	else {
+		index = node_count_.load(std::memory_order_relaxed);
+		assert(index < max_node_chunks * node_chunk_size);
+
+		auto& chunk = node_chunks_[index >> node_chunk_bits];
+		if (!chunk)
+			chunk = std::make_unique<buffer_node[]>(node_chunk_size);
+	}
+
+	buffer_node& node = get_node(index);
+	for (auto& buf : node.buffers)
+		buf = std::make_unique<buffer>(this, vertices_reserve_size, indices_reserve_size, batches_reserve_size);
+
+	if (node.free) {
+		node.working = 0;
+		node.active = 1;
+		node.ready.store(2, std::memory_order_relaxed);
+		node.children.clear();
+		node.free = false;
+		node.parent = std::numeric_limits<size_t>::max();
+		node.id_generation++;
+
+		node.generations = {};
+		node.generation = 0;
+		node.upload = {};
+		node.retain_unchanged.store(false, std::memory_order_relaxed);
+		node.mode.store(mailbox, std::memory_order_relaxed);
+		node.frames_published.store(0, std::memory_order_relaxed);
+		node.frames_presented.store(0, std::memory_order_relaxed);
+		node.frames_dropped.store(0, std::memory_order_relaxed);
+	}
+	else {
+		node_count_.store(index + 1, std::memory_order_release);
+	}
+
+	return (size_t)node.id_generation << id_index_bits | index;
+}
+
+bool renderer::d3d11_renderer::is_valid_id(size_t id) const {
+	if ((id & id_index_mask) >= node_count_.load(std::memory_order_acquire))
+		return false;
+
+	const auto& node = get_node(id);
+	return !node.free && node.id_generation == id >> id_index_bits;
+}
+
+void renderer::d3d11_renderer::publish_draw_order() {
+	auto order = std::make_shared<draw_order>();
+	order->positions.assign(node_count_.load(std::memory_order_relaxed), draw_order::npos);
+
+	// Pre-order walk with an explicit stack, children are pushed reversed so they come out in their sorted order
+	std::vector<size_t> pending;
+	std::vector<size_t> parents;
+	for (auto it = priorities_.rbegin(); it != priorities_.rend(); ++it)
+		pending.push_back(it->second);
+
+	while (!pending.empty()) {
+		const size_t id = pending.back();
+		pending.pop_back();
+
+		auto& node = get_node(id);
+		const size_t position = order->entries.size();
+		order->positions[id & id_index_mask] = position;
+		order->entries.push_back({ &node, id, position + 1 });
+		parents.push_back(node.parent == std::numeric_limits<size_t>::max() ? draw_order::npos
+																			  : order->positions[node.parent & id_index_mask]);
+
+		for (auto it = node.children.rbegin(); it != node.children.rend(); ++it)
+			pending.push_back(it->second);
+	}
+
+	// Descendants always come after their parent, so one backwards pass extends every range over its subtree
+	for (size_t position = order->entries.size(); position-- > 0;) {
+		if (parents[position] != draw_order::npos)
+			order->entries[parents[position]].subtree_end =
+			std::max(order->entries[parents[position]].subtree_end, order->entries[position].subtree_end);
+	}
+
+	std::erase_if(live_draw_orders_, [](const auto& live) { return live.expired(); });
+	live_draw_orders_.emplace_back(order);
+	draw_order_.store(std::move(order), std::memory_order_release);
+}
+
 size_t renderer::d3d11_renderer::register_buffer(size_t priority,
 												 size_t vertices_reserve_size,
 												 size_t indices_reserve_size,
-												 size_t batches_reserve_size) {
+												 size_t batches_reserve_size,
+												 buffer_mode mode) {
 	std::unique_lock lock_guard(buffer_list_mutex_);
 
-	const auto id = buffers_.size();
-	buffers_.emplace_back(std::make_unique<buffer>(this,
-												   vertices_reserve_size,
-												   indices_reserve_size,
-												   batches_reserve_size),
-						  std::make_unique<buffer>(this,
-												   vertices_reserve_size,
-												   indices_reserve_size,
-												   batches_reserve_size));
+	const auto id = create_node(vertices_reserve_size, indices_reserve_size, batches_reserve_size);
+	get_node(id).mode.store(mode, std::memory_order_relaxed);
 
     priorities_.emplace_back(priority, id);
-    std::sort(priorities_.begin(),priorities_.end(), [](auto& first, auto& sec) -> bool {
+    std::stable_sort(priorities_.begin(), priorities_.end(), [](auto& first, auto& sec) -> bool {
         return first.first < sec.first;
     });
 
+	publish_draw_order();
 	return id;
 }
 
@@ -72,26 +164,18 @@ size_t renderer::d3d11_renderer::register_child_buffer(size_t parent,
                                                        size_t indices_reserve_size,
                                                        size_t batches_reserve_size) {
     std::unique_lock lock_guard(buffer_list_mutex_);
+    assert(is_valid_id(parent));
 
-    const auto id = buffers_.size();
-    auto& child_buffer = buffers_.emplace_back(std::make_unique<buffer>(this,
-                                                   vertices_reserve_size,
-                                                   indices_reserve_size,
-                                                   batches_reserve_size),
-                          std::make_unique<buffer>(this,
-                                                   vertices_reserve_size,
-                                                   indices_reserve_size,
-                                                   batches_reserve_size));
-
-    child_buffer.parent = parent;
-
-    auto& parent_child_buffers = buffers_[parent].child_buffers;
-    parent_child_buffers.emplace_back(priority, id);
+    const auto id = create_node(vertices_reserve_size, indices_reserve_size, batches_reserve_size);
+    get_node(id).parent = parent;
 
-    std::sort(parent_child_buffers.begin(), parent_child_buffers.end(), [](auto& first, auto& sec) -> bool {
+    auto& children = get_node(parent).children;
+    children.emplace_back(priority, id);
+    std::stable_sort(children.begin(), children.end(), [](auto& first, auto& sec) -> bool {
         return first.first > sec.first;
     });
 
+    publish_draw_order();
     return id;
 }
 
@@ -106,79 +190,111 @@ void renderer::d3d11_renderer::update_buffer_priority(size_t id, size_t priority
         return;
 
     it->first = priority;
+    std::stable_sort(priorities_.begin(), priorities_.end(), [](auto& first, auto& sec) -> bool {
+        return first.first < sec.first;
+    });
+
+    publish_draw_order();
 }
 
 void renderer::d3d11_renderer::update_child_buffer_priority(size_t id, size_t priority) {
     std::unique_lock lock_guard(buffer_list_mutex_);
+    assert(is_valid_id(id));
 
-    auto& parent = buffers_[buffers_[id].parent];
-
-    const auto it = std::find_if(parent.child_buffers.begin(), parent.child_buffers.end(), [id](auto& pair) {
+    auto& children = get_node(get_node(id).parent).children;
+    const auto it = std::find_if(children.begin(), children.end(), [id](auto& pair) {
         return (pair.second == id);
     });
 
-    if (it != parent.child_buffers.end()) {
-        it->first = priority;
-        std::sort(parent.child_buffers.begin(), parent.child_buffers.end(), [](auto& first, auto& sec) -> bool {
-            return first.first > sec.first;
-        });
-    }
+    if (it == children.end())
+        return;
+
+    it->first = priority;
+    std::stable_sort(children.begin(), children.end(), [](auto& first, auto& sec) -> bool {
+        return first.first > sec.first;
+    });
+
+    publish_draw_order();
 }
 
 void renderer::d3d11_renderer::remove_buffer(size_t id) {
     std::unique_lock lock_guard(buffer_list_mutex_);
+    assert(is_valid_id(id));
 
-    const auto free_buffer = [this](const size_t id, auto& self_ref) -> void {
-        auto& buf = buffers_[id];
+    const auto order = draw_order_.load(std::memory_order_relaxed);
+    const auto& entries = order->entries;
+    const size_t position = order->positions[id & id_index_mask];
 
-        buf.free = true;
-        buf.active->clear();
-        buf.working->clear();
+    auto& node = get_node(id);
+    if (node.parent == std::numeric_limits<size_t>::max())
+        std::erase_if(priorities_, [id](auto& pair) { return pair.second == id; });
+    else
+        std::erase_if(get_node(node.parent).children, [id](auto& pair) { return pair.second == id; });
 
-        if (buf.parent != std::numeric_limits<size_t>::max()) {
-            auto& parent = buffers_[buf.parent];
+    // The producers have to be done with the slot and its children, every buffer of them is cleared here
+    for (size_t i = position; i < entries[position].subtree_end; i++) {
+        buffer_node& removed = *entries[i].node;
 
-            const auto it = std::find_if(parent.child_buffers.begin(), parent.child_buffers.end(), [id](auto& pair){
-                return pair.second == id;
-            });
+        removed.free = true;
+        for (auto& node_buffer : removed.buffers)
+            node_buffer->clear();
 
-            if (it != parent.child_buffers.end())
-                parent.child_buffers.erase(it);
-        }
+        free_buffers_.push_back({ entries[i].id & id_index_mask, live_draw_orders_ });
+    }
 
-        for (auto& child : buf.child_buffers) {
-            self_ref(child.second, self_ref);
-        }
+    publish_draw_order();
+}
 
-        free_buffers_.emplace_back(id);
-    };
+renderer::buffer* renderer::d3d11_renderer::get_working_buffer(const size_t id) {
+	assert(is_valid_id(id));
 
-    free_buffer(id, free_buffer);
+	return get_node(id).get_working();
 }
 
-renderer::buffer* renderer::d3d11_renderer::get_working_buffer(const size_t id) {
-	std::shared_lock lock_guard(buffer_list_mutex_);
+void renderer::d3d11_renderer::swap_buffers(size_t id) {
+	assert(is_valid_id(id));
+
+	// Children are swapped along with their parent, they follow it in the draw order
+	const auto order = draw_order_.load(std::memory_order_acquire);
+	const size_t position = order->positions[id & id_index_mask];
+	for (size_t i = position; i < order->entries[position].subtree_end; i++) {
+		buffer_node& node = *order->entries[i].node;
+		if (!node.get_working()->get_write_count() && node.retain_unchanged.load(std::memory_order_relaxed))
+			continue;
+
+		node.get_working()->flush_transform();
+		node.publish();
+		node.get_working()->clear();
+	}
+}
+
+void renderer::d3d11_renderer::set_buffer_mode(size_t id, buffer_mode mode) {
+	assert(is_valid_id(id));
 
-	assert(id < buffers_.size());
+	auto& buf = get_node(id);
+	buf.mode.store(mode, std::memory_order_relaxed);
 
-	return buffers_[id].working.get();
+	// Wake a producer waiting in fifo mode so it re-checks
+	buf.ready.notify_all();
 }
 
-void renderer::d3d11_renderer::swap_buffers(size_t id) {
-	std::unique_lock lock_guard(buffer_list_mutex_);
+void renderer::d3d11_renderer::set_buffer_deferred(size_t id, bool enabled) {
+	assert(is_valid_id(id));
+
+	for (auto& buf : get_node(id).buffers)
+		buf->set_deferred(enabled);
+}
 
-	assert(id < buffers_.size());
+void renderer::d3d11_renderer::set_buffer_retained(size_t id, bool enabled) {
+	assert(is_valid_id(id));
 
-    const auto swap_buffer = [this](const size_t id, const auto& self_ref) -> void {
-        auto& buf = buffers_[id];
-        buf.active.swap(buf.working);
-        buf.working->clear();
+	get_node(id).retain_unchanged.store(enabled, std::memory_order_relaxed);
+}
 
-        for (auto& child : buf.child_buffers)
-            self_ref(child.second, self_ref);
-    };
+renderer::buffer_stats renderer::d3d11_renderer::get_buffer_stats(size_t id) const {
+	assert(is_valid_id(id));
 
-	swap_buffer(id, swap_buffer);
+	return get_node(id).get_stats();
 }
 
 void renderer::d3d11_renderer::create_atlases() {
@@ -186,60 +302,72 @@ void renderer::d3d11_renderer::create_atlases() {
 		return;
 
 	for (auto&& atlas : atlases_handler.atlases) {
-		if (atlas->texture.data) {
-			atlas->texture.data->Release();
-			atlas->texture.data = nullptr;
+		for (auto&& page : atlas->texture.pages) {
+			if (page.data) {
+				page.data->Release();
+				page.data = nullptr;
+			}
 		}
 
-		if (atlas->texture.pixels_alpha8.empty()) {
+		if (!atlas->texture.is_built()) {
 			if (atlas->configs.empty())
 				atlas->add_font_default();
 
 			atlas->build();
 		}
 
-		atlas->texture.get_data_as_rgba32();
+		const bool use_rgba32 = atlas->texture.use_rgba32;
+		const DXGI_FORMAT format = use_rgba32 ? DXGI_FORMAT_R8G8B8A8_UNORM : DXGI_FORMAT_R8_UNORM;
 
-		D3D11_TEXTURE2D_DESC texture_desc{ .Width{ (std::uint32_t)atlas->texture.size.x },
-										   .Height{ (std::uint32_t)atlas->texture.size.y },
-										   .MipLevels{ 1 },
-										   .ArraySize{ 1 },
-										   .Format{ DXGI_FORMAT_R8G8B8A8_UNORM },
-										   .SampleDesc{ .Count{ 1 } },
-										   .Usage{ D3D11_USAGE_DEFAULT },
-										   .BindFlags{ D3D11_BIND_SHADER_RESOURCE },
-										   .CPUAccessFlags{ 0 } };
+		auto device = context_->device_resources_->get_device();
+		for (auto&& page : atlas->texture.pages) {
+			if (use_rgba32)
+				page.get_data_as_rgba32();
+
+			D3D11_TEXTURE2D_DESC texture_desc{ .Width{ (std::uint32_t)page.size.x },
+											   .Height{ (std::uint32_t)page.size.y },
+											   .MipLevels{ 1 },
+											   .ArraySize{ 1 },
+											   .Format{ format },
+											   .SampleDesc{ .Count{ 1 } },
+											   .Usage{ D3D11_USAGE_DEFAULT },
+											   .BindFlags{ D3D11_BIND_SHADER_RESOURCE },
+											   .CPUAccessFlags{ 0 } };
+
+			ID3D11Texture2D* texture = nullptr;
+			D3D11_SUBRESOURCE_DATA subresource{
+				.pSysMem{ use_rgba32 ? (void*)page.pixels_rgba32.data() : (void*)page.pixels_alpha8.data() },
+				.SysMemPitch{ texture_desc.Width * (use_rgba32 ? 4 : 1) },
+				.SysMemSlicePitch{ 0 }
+			};
+
+			if (auto result = device->CreateTexture2D(&texture_desc, &subresource, &texture); FAILED(result)) {
+				// TODO: Assert
+			}
 
-		ID3D11Texture2D* texture = nullptr;
-		D3D11_SUBRESOURCE_DATA subresource{ .pSysMem{ (void*)atlas->texture.pixels_rgba32.data() },
-											.SysMemPitch{ texture_desc.Width * 4 },
-											.SysMemSlicePitch{ 0 } };
+			ID3D11ShaderResourceView* texture_view = nullptr;
+			D3D11_SHADER_RESOURCE_VIEW_DESC shader_resource_view_desc{
+				.Format{ format },
+				.ViewDimension{ D3D11_SRV_DIMENSION_TEXTURE2D },
+				.Texture2D{ .MostDetailedMip{ 0 }, .MipLevels{ texture_desc.MipLevels } }
+			};
 
-		auto device = context_->device_resources_->get_device();
-		if (auto result = device->CreateTexture2D(&texture_desc, &subresource, &texture); FAILED(result)) {
-			// TODO: Assert
-		}
+			if (auto result = device->CreateShaderResourceView(texture, &shader_resource_view_desc, &texture_view);
+				FAILED(result)) {
+				// TODO: Assert
+			}
 
-		ID3D11ShaderResourceView* texture_view = nullptr;
-		D3D11_SHADER_RESOURCE_VIEW_DESC shader_resource_view_desc{
-			.Format{ DXGI_FORMAT_R8G8B8A8_UNORM },
-			.ViewDimension{ D3D11_SRV_DIMENSION_TEXTURE2D },
-			.Texture2D{ .MostDetailedMip{ 0 }, .MipLevels{ texture_desc.MipLevels } }
-		};
+			if (auto result = texture->Release(); FAILED(result)) {
+				// TODO: Assert
+			}
 
-		if (auto result = device->CreateShaderResourceView(texture, &shader_resource_view_desc, &texture_view);
-			FAILED(result)) {
-			// TODO: Assert
-		}
+			page.data = texture_view;
 
-		if (auto result = texture->Release(); FAILED(result)) {
-			// TODO: Assert
+			// The expanded copy only exists for the upload, the alpha8 pixels are kept to detect rebuilds
+			page.pixels_rgba32 = {};
 		}
 
-		atlas->texture.data = texture_view;
-
-		shared_data_->tex_uv_white_pixel = atlas->tex_uv_white_pixel;
-		shared_data_->tex_uv_lines = atlas->tex_uv_lines;
+		atlas->publish_snapshot();
 	}
 
 	atlases_handler.changed = false;
@@ -247,13 +375,17 @@ void renderer::d3d11_renderer::create_atlases() {
 
 void renderer::d3d11_renderer::destroy_atlases() {
 	for (auto&& atlas : atlases_handler.atlases) {
-		if (atlas->texture.data) {
-			if (auto result = atlas->texture.data->Release(); FAILED(result)) {
-				// TODO: Assert
-			}
+		for (auto&& page : atlas->texture.pages) {
+			if (page.data) {
+				if (auto result = page.data->Release(); FAILED(result)) {
+					// TODO: Assert
+				}
 
-			atlas->texture.data = nullptr;
+				page.data = nullptr;
+			}
 		}
+
+		atlas->reset_snapshot();
 	}
 
 	atlases_handler.changed = true;
@@ -270,10 +402,19 @@ void renderer::d3d11_renderer::render() {
 	setup_states();
 
     {
-        std::unique_lock lock_guard(buffer_list_mutex_);
+        std::shared_lock lock_guard(buffer_list_mutex_);
 
-        resize_buffers();
-        draw_batches();
+        const auto order = draw_order_.load(std::memory_order_acquire);
+
+        // Take the latest finished frame of every slot, producers keep drawing into their own buffers meanwhile.
+        // Deferred shapes are only tessellated for frames that actually get drawn
+        for (const auto& entry : order->entries) {
+            if (entry.node->acquire())
+                entry.node->get_active()->tessellate_shapes();
+        }
+
+        resize_buffers(*order);
+        draw_batches(*order);
     }
 
     const auto context = context_->device_resources_->get_device_context();
@@ -319,50 +460,62 @@ void renderer::d3d11_renderer::clear() {
 	}
 }
 
-void renderer::d3d11_renderer::draw_batches() {
+void renderer::d3d11_renderer::draw_batches(const draw_order& order) {
 	const auto context = context_->device_resources_->get_device_context();
 	const auto command_buffer = context_->device_resources_->get_command_buffer();
 
-	int32_t global_idx_offset = 0;
-	int32_t global_vtx_offset = 0;
+    // Commands carry their own topology, it's only set when it changes
+    D3D11_PRIMITIVE_TOPOLOGY topology = D3D11_PRIMITIVE_TOPOLOGY_UNDEFINED;
 
-    const auto draw_commands = [&](buffer* active) {
-		context->IASetPrimitiveTopology(active->get_topology());
+    const auto draw_commands = [&](const buffer_node& node) {
+        const buffer* active = node.get_active();
+
+        // Where resize_buffers placed the slot's geometry
+        const auto base_idx_offset = (UINT)(node.upload.indices_offset / sizeof(uint32_t));
+        const auto base_vtx_offset = (INT)(node.upload.vertices_offset / sizeof(vertex));
 
         const auto& draw_cmds = active->get_draw_cmds();
 
-        context_->device_resources_->set_command_buffer(active->get_active_command());
+        auto active_command = active->get_active_command();
+        active_command.is_mask = draw_cmds.empty() ? 0 : is_mask_texture(draw_cmds[0].texture);
+
+        context_->device_resources_->set_command_buffer(active_command);
         context_->device_resources_->set_projection(active->get_projection());
 
         context->PSSetConstantBuffers(0, 1, &command_buffer);
 
         for (const auto& draw_command : draw_cmds) {
+            // Single channel atlases are sampled as coverage, anything else as color
+            if (const uint32_t is_mask = is_mask_texture(draw_command.texture); is_mask != active_command.is_mask) {
+                active_command.is_mask = is_mask;
+                context_->device_resources_->set_command_buffer(active_command);
+            }
+
+            if (draw_command.topology != topology) {
+                topology = draw_command.topology;
+                context->IASetPrimitiveTopology(topology);
+            }
+
             context->PSSetShaderResources(0, 1, &draw_command.texture);
 
             context->DrawIndexed(draw_command.elem_count,
-                                 draw_command.idx_offset + global_idx_offset,
-                                 draw_command.vtx_offset + global_vtx_offset);
+                                 draw_command.idx_offset + base_idx_offset,
+                                 draw_command.vtx_offset + base_vtx_offset);
         }
-
-        global_idx_offset += active->get_indices().Size;
-        global_vtx_offset += active->get_vertices().Size;
     };
 
-    const auto draw_child_commands = [&, this](const auto& children, const auto& self_ref) -> void {
-        for (const auto& [priority, id] : children) {
-            const auto& child_buffer = buffers_[id];
-            draw_commands(child_buffer.active.get());
-            if (!child_buffer.child_buffers.empty())
-                self_ref(child_buffer.child_buffers, self_ref);
-        }
-    };
+    for (const auto& entry : order.entries)
+        draw_commands(*entry.node);
+}
 
-    for (const auto& [priority, id] : priorities_) {
-        const auto& node = buffers_[id];
+bool renderer::d3d11_renderer::is_mask_texture(ID3D11ShaderResourceView* texture) {
+	if (!texture)
+		return false;
 
-        draw_commands(node.active.get());
-        draw_child_commands(node.child_buffers, draw_child_commands);
-    }
+	// Checked on the view itself, buffers can still hold pages of an atlas version that was already replaced
+	D3D11_SHADER_RESOURCE_VIEW_DESC desc{};
+	texture->GetDesc(&desc);
+	return desc.Format == DXGI_FORMAT_R8_UNORM;
 }
 
 void renderer::d3d11_renderer::on_window_moved() {
@@ -455,8 +608,10 @@ void renderer::d3d11_renderer::create_window_size_dependent_resources() {
 void renderer::d3d11_renderer::on_device_lost() {
     std::unique_lock lock_guard(buffer_list_mutex_);
 
-    for (const auto& buffer : buffers_) {
-        buffer.active->clear();
+    staging_invalid_ = true;
+
+    for (size_t id = 0; id < node_count_.load(std::memory_order_acquire); id++) {
+        get_node(id).get_active()->clear();
     }
 }
 
@@ -466,71 +621,103 @@ void renderer::d3d11_renderer::on_device_restored() {
 	create_window_size_dependent_resources();
 }
 
-void renderer::d3d11_renderer::resize_buffers() {
+void renderer::d3d11_renderer::resize_buffers(const draw_order& order) {
 	const auto context = context_->device_resources_->get_device_context();
 	auto vertex_buffer = context_->device_resources_->get_vertex_buffer();
 	const auto vertex_buffer_size = context_->device_resources_->get_vertex_buffer_size();
 	auto index_buffer = context_->device_resources_->get_index_buffer();
 	const auto index_buffer_size = context_->device_resources_->get_index_buffer_size();
 
-	size_t vertex_count = 0;
-	size_t index_count = 0;
+	const auto make_chunk = [](const buffer_node& node) -> staging_chunk {
+		const buffer* active = node.get_active();
+		return { .vertices{ active->get_vertices().Data },
+				 .vertices_size{ active->get_vertices().size() * sizeof(vertex) },
+				 .indices{ active->get_indices().Data },
+				 .indices_size{ active->get_indices().size() * sizeof(uint32_t) } };
+	};
+
+	// Only slots that published a new frame since their last upload are copied, the rest keep their region
+	staging_chunks_.clear();
+	for (const auto& entry : order.entries) {
+		buffer_node* node = entry.node;
+		const uint64_t generation = node->get_active_generation();
+		if (node->upload.placed && node->upload.generation == generation)
+			continue;
 
-	for (const auto& buffer : buffers_) {
-        const auto& active = buffer.active;
+		node->upload.generation = generation;
+		node->upload.placed = false;
+		staging_chunks_.push_back(make_chunk(*node));
+	}
 
-		vertex_count += active->get_vertices().size();
-		index_count += active->get_indices().size();
+	staging_totals changed{};
+	for (const staging_chunk& chunk : staging_chunks_) {
+		changed.vertices_size += chunk.vertices_size;
+		changed.indices_size += chunk.indices_size;
 	}
 
-	if (vertex_count > 0) {
-		if (!vertex_buffer || vertex_buffer_size <= vertex_count || !index_buffer || index_buffer_size <= index_count) {
+	// Changed slots are appended after everything in use so no region a queued draw may still read is overwritten,
+	// once that runs out every slot is laid out again from the start of freshly discarded buffers
+	const bool compact = staging_invalid_ || !vertex_buffer || !index_buffer ||
+						 staging_end_.vertices_size + changed.vertices_size > vertex_buffer_size * sizeof(vertex) ||
+						 staging_end_.indices_size + changed.indices_size > index_buffer_size * sizeof(uint32_t);
+
+	if (compact) {
+		staging_chunks_.clear();
+		// Laid out in draw order
+		for (const auto& entry : order.entries) {
+			entry.node->upload.placed = false;
+			staging_chunks_.push_back(make_chunk(*entry.node));
+		}
+
+		staging_end_ = plan_staging(staging_chunks_);
+		changed = staging_end_;
+
+		// Leave as much room again for changed slots so compacting stays rare
+		const size_t vertex_count = staging_end_.vertices_size / sizeof(vertex) * 2;
+		const size_t index_count = staging_end_.indices_size / sizeof(uint32_t) * 2;
+		if (vertex_count > 0 &&
+			(!vertex_buffer || vertex_buffer_size < vertex_count || !index_buffer || index_buffer_size < index_count)) {
 			context_->device_resources_->resize_buffers(vertex_count, index_count);
 			vertex_buffer = context_->device_resources_->get_vertex_buffer();
 			index_buffer = context_->device_resources_->get_index_buffer();
 		}
+	}
+	else {
+		staging_end_ = plan_staging(staging_chunks_, staging_end_);
+	}
 
-		if (vertex_buffer && index_buffer) {
-            D3D11_MAPPED_SUBRESOURCE vtx_resource;
-            HRESULT hr = context->Map(vertex_buffer, 0, D3D11_MAP_WRITE_DISCARD, 0, &vtx_resource);
-            assert(SUCCEEDED(hr));
-
-            D3D11_MAPPED_SUBRESOURCE idx_resource;
-            hr = context->Map(index_buffer, 0, D3D11_MAP_WRITE_DISCARD, 0, &idx_resource);
-            assert(SUCCEEDED(hr));
-
-            auto* vtx_dst = (vertex*)vtx_resource.pData;
-            auto* idx_dst = (uint32_t*)idx_resource.pData;
+	if (vertex_buffer && index_buffer && (changed.vertices_size > 0 || changed.indices_size > 0)) {
+		const D3D11_MAP map_type = compact ? D3D11_MAP_WRITE_DISCARD : D3D11_MAP_WRITE_NO_OVERWRITE;
 
-            const auto copy_active_buffer_data = [&](buffer* active) {
-                memcpy(vtx_dst, active->get_vertices().Data, active->get_vertices().size() * sizeof(vertex));
-                memcpy(idx_dst, active->get_indices().Data, active->get_indices().size() * sizeof(uint32_t));
+		D3D11_MAPPED_SUBRESOURCE vtx_resource;
+		HRESULT hr = context->Map(vertex_buffer, 0, map_type, 0, &vtx_resource);
+		assert(SUCCEEDED(hr));
 
-                vtx_dst += active->get_vertices().size();
-                idx_dst += active->get_indices().size();
-            };
+		D3D11_MAPPED_SUBRESOURCE idx_resource;
+		hr = context->Map(index_buffer, 0, map_type, 0, &idx_resource);
+		assert(SUCCEEDED(hr));
 
-            const auto copy_child_data = [&](const auto& children, const auto& self_ref) -> void {
-                for (const auto& [priority, id] : children) {
-                    const auto& child_buffer = buffers_[id];
-                    copy_active_buffer_data(child_buffer.active.get());
-                    if (!child_buffer.child_buffers.empty())
-                        self_ref(child_buffer.child_buffers, self_ref);
-                }
-            };
+		staging_copier_.copy(staging_chunks_, vtx_resource.pData, idx_resource.pData);
 
-            for (const auto& [priority, id] : priorities_) {
-                const auto& node = buffers_[id];
+		context->Unmap(vertex_buffer, 0);
+		context->Unmap(index_buffer, 0);
+	}
 
-                copy_active_buffer_data(node.active.get());
-                copy_child_data(node.child_buffers, copy_child_data);
-            }
+	// Chunks were collected in walk order from the slots that aren't placed
+	auto chunk = staging_chunks_.begin();
+	for (const auto& entry : order.entries) {
+		buffer_node* node = entry.node;
+		if (node->upload.placed)
+			continue;
 
-            context->Unmap(vertex_buffer, 0);
-            context->Unmap(index_buffer, 0);
-		}
+		node->upload.vertices_offset = chunk->vertices_offset;
+		node->upload.indices_offset = chunk->indices_offset;
+		node->upload.placed = true;
+		++chunk;
 	}
 
+	staging_invalid_ = !vertex_buffer || !index_buffer;
+
 	UINT stride = sizeof(vertex);
 	UINT offset = 0;
 	context->IASetVertexBuffers(0, 1, &vertex_buffer, &stride, &offset);
@@ -0,0 +1,319 @@
+#include "renderer/util/compression.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+
+namespace {
+	uint32_t read_be32(const uint8_t* data) {
+		return (uint32_t)data[0] << 24 | (uint32_t)data[1] << 16 | (uint32_t)data[2] << 8 | (uint32_t)data[3];
+	}
+
+	uint32_t read_le32(const uint8_t* data) {
+		uint32_t value;
+		memcpy(&value, data, sizeof(value));
+		return value;
+	}
+
+	uint32_t adler32(uint32_t adler, const uint8_t* data, size_t size) {
+		constexpr uint32_t adler_mod = 65521;
+		uint32_t s1 = adler & 0xFFFF, s2 = adler >> 16;
+
+		// 5552 is the most bytes that can be summed before s2 could overflow
+		while (size) {
+			const size_t block_size = std::min<size_t>(size, 5552);
+			for (size_t i = 0; i < block_size; i++) {
+				s1 += data[i];
+				s2 += s1;
+			}
+
+			s1 %= adler_mod;
+			s2 %= adler_mod;
+			data += block_size;
+			size -= block_size;
+		}
+
+		return s2 << 16 | s1;
+	}
+
+	// Port of stb.h's stb_decompress with the globals moved into a struct and bounds checks on the input
+	struct stb_decompressor {
+		const uint8_t* in_begin;
+		const uint8_t* in_end;
+		uint8_t* out_begin;
+		uint8_t* out_end;
+		uint8_t* out;
+		bool failed = false;
+
+		void match(const uint8_t* data, uint32_t length) {
+			if (out + length > out_end || data < out_begin) {
+				failed = true;
+				return;
+			}
+
+			// Overlapping copies have to go forward one byte at a time
+			while (length--)
+				*out++ = *data++;
+		}
+
+		void literal(const uint8_t* data, uint32_t length) {
+			if (out + length > out_end || data < in_begin || data + length > in_end) {
+				failed = true;
+				return;
+			}
+
+			memcpy(out, data, length);
+			out += length;
+		}
+
+		const uint8_t* token(const uint8_t* i) {
+			const auto in2 = [i](int x) { return (uint32_t)i[x] << 8 | i[x + 1]; };
+			const auto in3 = [i, in2](int x) { return (uint32_t)i[x] << 16 | in2(x + 1); };
+
+			if (*i >= 0x20) {
+				if (*i >= 0x80)
+					match(out - i[1] - 1, i[0] - 0x80 + 1), i += 2;
+				else if (*i >= 0x40)
+					match(out - (in2(0) - 0x4000) - 1, i[2] + 1), i += 3;
+				else
+					literal(i + 1, i[0] - 0x20 + 1), i += 1 + (i[0] - 0x20 + 1);
+			}
+			else {
+				if (*i >= 0x18)
+					match(out - (in3(0) - 0x180000) - 1, i[3] + 1), i += 4;
+				else if (*i >= 0x10)
+					match(out - (in3(0) - 0x100000) - 1, in2(3) + 1), i += 5;
+				else if (*i >= 0x08)
+					literal(i + 2, in2(0) - 0x0800 + 1), i += 2 + (in2(0) - 0x0800 + 1);
+				else if (*i == 0x07)
+					literal(i + 3, in2(1) + 1), i += 3 + (in2(1) + 1);
+				else if (*i == 0x06)
+					match(out - (in3(1) + 1), i[4] + 1), i += 5;
+				else if (*i == 0x04)
+					match(out - (in3(1) + 1), in2(4) + 1), i += 6;
+			}
+
+			return i;
+		}
+	};
+
+	void lz4_write_length(std::vector<uint8_t>& output, size_t length) {
+		for (; length >= 255; length -= 255)
+			output.push_back(255);
+		output.push_back((uint8_t)length);
+	}
+
+	void lz4_write_sequence(
+	std::vector<uint8_t>& output, const uint8_t* literals, size_t literal_length, size_t offset, size_t match_length) {
+		const size_t match_code = match_length ? match_length - 4 : 0;
+		output.push_back((uint8_t)(std::min<size_t>(literal_length, 15) << 4 | std::min<size_t>(match_code, 15)));
+		if (literal_length >= 15)
+			lz4_write_length(output, literal_length - 15);
+
+		output.insert(output.end(), literals, literals + literal_length);
+
+		// The last sequence only carries literals
+		if (!match_length)
+			return;
+
+		output.push_back((uint8_t)(offset & 0xFF));
+		output.push_back((uint8_t)(offset >> 8));
+		if (match_code >= 15)
+			lz4_write_length(output, match_code - 15);
+	}
+}// namespace
+
+size_t renderer::stb_decompress_length(std::span<const uint8_t> input) {
+	if (input.size() < 16 || read_be32(input.data()) != stb_compressed_magic)
+		return 0;
+
+	return read_be32(input.data() + 8);
+}
+
+size_t renderer::stb_decompress(std::span<uint8_t> output, std::span<const uint8_t> input) {
+	if (input.size() < 16 || read_be32(input.data()) != stb_compressed_magic)
+		return 0;
+
+	// Streams bigger than 4GB aren't supported
+	if (read_be32(input.data() + 4) != 0)
+		return 0;
+
+	const size_t length = read_be32(input.data() + 8);
+	if (output.size() < length)
+		return 0;
+
+	stb_decompressor decompressor{ .in_begin{ input.data() },
+								   .in_end{ input.data() + input.size() },
+								   .out_begin{ output.data() },
+								   .out_end{ output.data() + length },
+								   .out{ output.data() } };
+
+	// Tokens are at most 6 bytes, the stream ends with 0x05 0xFA followed by the adler32 of the output
+	const uint8_t* i = input.data() + 16;
+	while (i + 6 <= decompressor.in_end) {
+		const uint8_t* token = i;
+		i = decompressor.token(i);
+		if (decompressor.failed)
+			return 0;
+
+		if (i != token)
+			continue;
+
+		if (i[0] != 0x05 || i[1] != 0xFA || decompressor.out != decompressor.out_end)
+			return 0;
+
+		if (adler32(1, output.data(), length) != read_be32(i + 2))
+			return 0;
+
+		return length;
+	}
+
+	return 0;
+}
+
+std::vector<uint8_t> renderer::lz4_compress(std::span<const uint8_t> input) {
+	constexpr size_t hash_bits = 16;
+	constexpr size_t min_match = 4;
+	// A match has to start 12 bytes before the end and the last 5 bytes are always literals
+	constexpr size_t match_start_margin = 12;
+	constexpr size_t literals_margin = 5;
+
+	std::vector<uint8_t> output;
+	output.reserve(input.size() + input.size() / 255 + 16);
+
+	const uint8_t* data = input.data();
+	const size_t size = input.size();
+
+	size_t anchor = 0;
+	if (size > match_start_margin) {
+		// Positions are stored plus one so zero means empty
+		std::vector<uint32_t> table(1 << hash_bits, 0);
+		const auto hash = [](uint32_t sequence) { return (sequence * 2654435761u) >> (32 - hash_bits); };
+
+		const size_t match_limit = size - match_start_margin;
+		const size_t end_limit = size - literals_margin;
+
+		size_t position = 0;
+		while (position < match_limit) {
+			const uint32_t sequence = read_le32(data + position);
+			uint32_t& slot = table[hash(sequence)];
+			const size_t candidate = slot;
+			slot = (uint32_t)position + 1;
+
+			if (!candidate || position - (candidate - 1) > 0xFFFF || read_le32(data + candidate - 1) != sequence) {
+				// Skip ahead faster through data that doesn't compress
+				position += 1 + ((position - anchor) >> 6);
+				continue;
+			}
+
+			const size_t reference = candidate - 1;
+			size_t length = min_match;
+			while (position + length < end_limit && data[reference + length] == data[position + length])
+				length++;
+
+			lz4_write_sequence(output, data + anchor, position - anchor, position - reference, length);
+			position += length;
+			anchor = position;
+
+			if (position - 2 < match_limit)
+				table[hash(read_le32(data + position - 2))] = (uint32_t)(position - 2) + 1;
+		}
+	}
+
+	lz4_write_sequence(output, data + anchor, size - anchor, 0, 0);
+	return output;
+}
+
+size_t renderer::lz4_decompress(std::span<uint8_t> output, std::span<const uint8_t> input) {
+	const uint8_t* in = input.data();
+	const uint8_t* in_end = in + input.size();
+	uint8_t* out = output.data();
+	uint8_t* out_end = out + output.size();
+
+	const auto read_length = [&](size_t length) -> size_t {
+		if (length != 15)
+			return length;
+
+		uint8_t byte;
+		do {
+			if (in >= in_end)
+				return std::numeric_limits<size_t>::max();
+
+			byte = *in++;
+			length += byte;
+		} while (byte == 255);
+
+		return length;
+	};
+
+	while (in < in_end) {
+		const uint8_t token = *in++;
+
+		const size_t literal_length = read_length(token >> 4);
+		if (literal_length > (size_t)(in_end - in) || literal_length > (size_t)(out_end - out))
+			return 0;
+
+		if (literal_length)
+			memcpy(out, in, literal_length);
+		in += literal_length;
+		out += literal_length;
+
+		// The last sequence has no match
+		if (in == in_end)
+			break;
+
+		if (in_end - in < 2)
+			return 0;
+
+		const size_t offset = (size_t)in[0] | (size_t)in[1] << 8;
+		in += 2;
+		if (!offset || offset > (size_t)(out - output.data()))
+			return 0;
+
+		const size_t match_length = read_length(token & 15);
+		if (match_length == std::numeric_limits<size_t>::max() || match_length + 4 > (size_t)(out_end - out))
+			return 0;
+
+		const uint8_t* match = out - offset;
+		if (offset >= match_length + 4) {
+			memcpy(out, match, match_length + 4);
+			out += match_length + 4;
+		}
+		else {
+			for (size_t n = 0; n < match_length + 4; n++)
+				*out++ = *match++;
+		}
+	}
+
+	return (size_t)(out - output.data());
+}
+
+std::vector<uint8_t> renderer::compress_binary(std::span<const uint8_t> input) {
+	const std::vector<uint8_t> block = lz4_compress(input);
+
+	std::vector<uint8_t> output;
+	output.reserve(lz4_compressed_header_size + block.size());
+	output.resize(lz4_compressed_header_size);
+	const uint32_t magic = lz4_compressed_magic;
+	const auto size = (uint32_t)input.size();
+	memcpy(output.data(), &magic, sizeof(magic));
+	memcpy(output.data() + 4, &size, sizeof(size));
+	output.insert(output.end(), block.begin(), block.end());
+
+	return output;
+}
+
+bool renderer::decompress_binary(std::span<const uint8_t> input, std::vector<char>& output) {
+	if (input.size() >= 16 && read_be32(input.data()) == stb_compressed_magic) {
+		output.resize(stb_decompress_length(input));
+		return stb_decompress(std::span((uint8_t*)output.data(), output.size()), input) == output.size();
+	}
+
+	if (input.size() >= lz4_compressed_header_size && read_le32(input.data()) == lz4_compressed_magic) {
+		output.resize(read_le32(input.data() + 4));
+		return lz4_decompress(std::span((uint8_t*)output.data(), output.size()),
+							  input.subspan(lz4_compressed_header_size)) == output.size();
+	}
+
+	return false;
+}
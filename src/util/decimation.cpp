@@ -0,0 +1,251 @@
+#include "renderer/util/decimation.hpp"
+
+#include <cmath>
+#include <emmintrin.h>
+#include <functional>
+#include <utility>
+
+namespace {
+	// Splits four consecutive points into their x and y lanes
+	void load_points(const glm::vec2* points, __m128& x, __m128& y) {
+		const __m128 lo = _mm_loadu_ps(&points[0].x);
+		const __m128 hi = _mm_loadu_ps(&points[2].x);
+		x = _mm_shuffle_ps(lo, hi, _MM_SHUFFLE(2, 0, 2, 0));
+		y = _mm_shuffle_ps(lo, hi, _MM_SHUFFLE(3, 1, 3, 1));
+	}
+
+	__m128i select(__m128 mask, __m128i a, __m128i b) {
+		const __m128i m = _mm_castps_si128(mask);
+		return _mm_or_si128(_mm_and_si128(m, a), _mm_andnot_si128(m, b));
+	}
+
+	// Lanes are reduced in order so ties keep the earliest point
+	template<typename compare_t>
+	void reduce_lanes(__m128 values, __m128i indices, float& best, size_t& best_index, compare_t compare) {
+		alignas(16) float lane_values[4];
+		alignas(16) int32_t lane_indices[4];
+		_mm_store_ps(lane_values, values);
+		_mm_store_si128((__m128i*)lane_indices, indices);
+
+		for (size_t lane = 0; lane < 4; lane++) {
+			const size_t index = (size_t)lane_indices[lane];
+			if (compare(lane_values[lane], best) || (lane_values[lane] == best && index < best_index)) {
+				best = lane_values[lane];
+				best_index = index;
+			}
+		}
+	}
+
+	// Point in (first, last) furthest from the line through first and last, returns its squared cross product with
+	// the segment which is the squared distance scaled by the segment's squared length
+	float find_furthest(const glm::vec2* points, size_t first, size_t last, size_t& furthest) {
+		const glm::vec2 a = points[first];
+		const glm::vec2 d = points[last] - a;
+
+		const __m128 ax = _mm_set1_ps(a.x);
+		const __m128 ay = _mm_set1_ps(a.y);
+		const __m128 dx = _mm_set1_ps(d.x);
+		const __m128 dy = _mm_set1_ps(d.y);
+
+		__m128 best = _mm_set1_ps(-1.f);
+		__m128i best_indices = _mm_set1_epi32((int32_t)first);
+		__m128i indices = _mm_setr_epi32((int32_t)first + 1, (int32_t)first + 2, (int32_t)first + 3, (int32_t)first + 4);
+		const __m128i step = _mm_set1_epi32(4);
+
+		size_t i = first + 1;
+		for (; i + 4 <= last; i += 4) {
+			__m128 x, y;
+			load_points(points + i, x, y);
+
+			const __m128 cross = _mm_sub_ps(_mm_mul_ps(_mm_sub_ps(x, ax), dy), _mm_mul_ps(_mm_sub_ps(y, ay), dx));
+			const __m128 dist = _mm_mul_ps(cross, cross);
+			const __m128 greater = _mm_cmpgt_ps(dist, best);
+			best = _mm_max_ps(dist, best);
+			best_indices = select(greater, indices, best_indices);
+			indices = _mm_add_epi32(indices, step);
+		}
+
+		float result = -1.f;
+		furthest = first;
+		reduce_lanes(best, best_indices, result, furthest, std::greater<>());
+
+		for (; i < last; i++) {
+			const glm::vec2 p = points[i] - a;
+			const float cross = p.x * d.y - p.y * d.x;
+			if (cross * cross > result) {
+				result = cross * cross;
+				furthest = i;
+			}
+		}
+
+		return result;
+	}
+
+	// Same as find_furthest for a segment that collapsed into a point, plain squared distances
+	float find_furthest_from_point(const glm::vec2* points, size_t first, size_t last, size_t& furthest) {
+		const glm::vec2 a = points[first];
+
+		float result = -1.f;
+		furthest = first;
+		for (size_t i = first + 1; i < last; i++) {
+			const glm::vec2 p = points[i] - a;
+			const float dist = p.x * p.x + p.y * p.y;
+			if (dist > result) {
+				result = dist;
+				furthest = i;
+			}
+		}
+
+		return result;
+	}
+}// namespace
+
+bool renderer::is_monotonic_x(std::span<const glm::vec2> points) {
+	const size_t count = points.size();
+
+	size_t i = 0;
+	for (; i + 5 <= count; i += 4) {
+		__m128 x, next_x, y;
+		load_points(&points[i], x, y);
+		load_points(&points[i + 1], next_x, y);
+
+		if (_mm_movemask_ps(_mm_cmplt_ps(next_x, x)))
+			return false;
+	}
+
+	for (; i + 1 < count; i++) {
+		if (points[i + 1].x < points[i].x)
+			return false;
+	}
+
+	return true;
+}
+
+void renderer::decimate_min_max(std::span<const glm::vec2> points, float column_width, std::vector<glm::vec2>& out) {
+	out.clear();
+
+	const size_t count = points.size();
+	if (count < 3 || !(column_width > 0.f)) {
+		out.assign(points.begin(), points.end());
+		return;
+	}
+
+	const glm::vec2* data = points.data();
+	const float origin = data[0].x;
+	const __m128i step = _mm_set1_epi32(4);
+
+	size_t first = 0;
+	while (first < count) {
+		const float column = std::floor((data[first].x - origin) / column_width);
+		const float column_end = origin + (column + 1.f) * column_width;
+
+		float min_y = data[first].y, max_y = data[first].y;
+		size_t min_index = first, max_index = first;
+
+		size_t i = first + 1;
+		if (i + 4 <= count && data[i + 3].x < column_end) {
+			__m128 min_lanes = _mm_set1_ps(min_y);
+			__m128 max_lanes = _mm_set1_ps(max_y);
+			__m128i min_indices = _mm_set1_epi32((int32_t)first);
+			__m128i max_indices = min_indices;
+			__m128i indices = _mm_setr_epi32((int32_t)i, (int32_t)i + 1, (int32_t)i + 2, (int32_t)i + 3);
+
+			// x never decreases so the whole block is inside the column when its last point is
+			for (; i + 4 <= count && data[i + 3].x < column_end; i += 4) {
+				__m128 x, y;
+				load_points(data + i, x, y);
+
+				min_indices = select(_mm_cmplt_ps(y, min_lanes), indices, min_indices);
+				max_indices = select(_mm_cmpgt_ps(y, max_lanes), indices, max_indices);
+				min_lanes = _mm_min_ps(y, min_lanes);
+				max_lanes = _mm_max_ps(y, max_lanes);
+				indices = _mm_add_epi32(indices, step);
+			}
+
+			reduce_lanes(min_lanes, min_indices, min_y, min_index, std::less<>());
+			reduce_lanes(max_lanes, max_indices, max_y, max_index, std::greater<>());
+		}
+
+		for (; i < count && data[i].x < column_end; i++) {
+			if (data[i].y < min_y) {
+				min_y = data[i].y;
+				min_index = i;
+			}
+			if (data[i].y > max_y) {
+				max_y = data[i].y;
+				max_index = i;
+			}
+		}
+
+		const size_t last = i - 1;
+		if (min_index > max_index)
+			std::swap(min_index, max_index);
+
+		out.push_back(data[first]);
+		if (min_index != first && min_index != last)
+			out.push_back(data[min_index]);
+		if (max_index != min_index && max_index != first && max_index != last)
+			out.push_back(data[max_index]);
+		if (last != first)
+			out.push_back(data[last]);
+
+		first = i;
+	}
+}
+
+void renderer::decimate_rdp(std::span<const glm::vec2> points, float tolerance, std::vector<glm::vec2>& out) {
+	out.clear();
+
+	const size_t count = points.size();
+	if (count < 3 || !(tolerance > 0.f)) {
+		out.assign(points.begin(), points.end());
+		return;
+	}
+
+	const glm::vec2* data = points.data();
+	const float tolerance_sq = tolerance * tolerance;
+
+	// Ranges are popped left to right so every range emits its first point in order, the end point of the whole path
+	// is added last. Worst case is quadratic, same as any plain rdp
+	std::vector<std::pair<size_t, size_t>> ranges;
+	ranges.emplace_back(0, count - 1);
+
+	while (!ranges.empty()) {
+		const auto [first, last] = ranges.back();
+		ranges.pop_back();
+
+		const glm::vec2 d = data[last] - data[first];
+		const float length_sq = d.x * d.x + d.y * d.y;
+
+		size_t furthest;
+		bool split;
+		if (length_sq > 0.f)
+			split = find_furthest(data, first, last, furthest) > tolerance_sq * length_sq;
+		else
+			split = find_furthest_from_point(data, first, last, furthest) > tolerance_sq;
+
+		if (split) {
+			ranges.emplace_back(furthest, last);
+			ranges.emplace_back(first, furthest);
+		} else {
+			out.push_back(data[first]);
+		}
+	}
+
+	out.push_back(data[count - 1]);
+}
+
+renderer::decimation_stats renderer::decimate_polyline(std::span<const glm::vec2> points,
+													   float tolerance,
+													   decimation_mode mode,
+													   std::vector<glm::vec2>& out) {
+	if (mode == decimation_mode::automatic)
+		mode = is_monotonic_x(points) ? decimation_mode::min_max : decimation_mode::rdp;
+
+	if (mode == decimation_mode::min_max)
+		decimate_min_max(points, tolerance, out);
+	else
+		decimate_rdp(points, tolerance, out);
+
+	return {points.size(), out.size()};
+}
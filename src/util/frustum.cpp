@@ -0,0 +1,92 @@
+#include "renderer/util/frustum.hpp"
+
+#include <emmintrin.h>
+#include <limits>
+
+renderer::frustum::frustum(const glm::mat4x4& view_projection) {
+	// glm is column major, clip = view_projection * pos so the planes are sums of its rows
+	const glm::mat4x4 rows = glm::transpose(view_projection);
+
+	// Near is w + z rather than z so projections with either depth range keep everything in front of the eye
+	planes_ = { rows[3] + rows[0], rows[3] - rows[0], rows[3] + rows[1],
+				rows[3] - rows[1], rows[3] + rows[2], rows[3] - rows[2] };
+
+	for (glm::vec4& plane : planes_) {
+		const float length = glm::length(glm::vec3(plane));
+		if (length > 0.f)
+			plane /= length;
+	}
+
+	w_row_ = rows[3];
+	y_scale_ = glm::length(glm::vec3(rows[1]));
+}
+
+bool renderer::frustum::test_sphere(const glm::vec3& center, float radius) const {
+	for (const glm::vec4& plane : planes_) {
+		if (glm::dot(glm::vec3(plane), center) + plane.w < -radius)
+			return false;
+	}
+
+	return true;
+}
+
+bool renderer::frustum::test_aabb(const glm::vec3& min, const glm::vec3& max) const {
+	for (const glm::vec4& plane : planes_) {
+		// Corner furthest along the plane normal
+		const glm::vec3 corner(
+		plane.x >= 0.f ? max.x : min.x, plane.y >= 0.f ? max.y : min.y, plane.z >= 0.f ? max.z : min.z);
+		if (glm::dot(glm::vec3(plane), corner) + plane.w < 0.f)
+			return false;
+	}
+
+	return true;
+}
+
+void renderer::frustum::cull_spheres(std::span<const glm::vec4> spheres, std::vector<uint32_t>& visible) const {
+	__m128 plane_x[6], plane_y[6], plane_z[6], plane_w[6];
+	for (size_t i = 0; i < planes_.size(); i++) {
+		plane_x[i] = _mm_set1_ps(planes_[i].x);
+		plane_y[i] = _mm_set1_ps(planes_[i].y);
+		plane_z[i] = _mm_set1_ps(planes_[i].z);
+		plane_w[i] = _mm_set1_ps(planes_[i].w);
+	}
+
+	const size_t count = spheres.size();
+
+	size_t i = 0;
+	for (; i + 4 <= count; i += 4) {
+		__m128 x = _mm_loadu_ps(&spheres[i].x);
+		__m128 y = _mm_loadu_ps(&spheres[i + 1].x);
+		__m128 z = _mm_loadu_ps(&spheres[i + 2].x);
+		__m128 r = _mm_loadu_ps(&spheres[i + 3].x);
+		_MM_TRANSPOSE4_PS(x, y, z, r);
+
+		const __m128 neg_r = _mm_sub_ps(_mm_setzero_ps(), r);
+		__m128 outside = _mm_setzero_ps();
+		for (size_t p = 0; p < 6; p++) {
+			const __m128 dist = _mm_add_ps(
+			_mm_add_ps(_mm_mul_ps(plane_x[p], x), _mm_mul_ps(plane_y[p], y)),
+			_mm_add_ps(_mm_mul_ps(plane_z[p], z), plane_w[p]));
+			outside = _mm_or_ps(outside, _mm_cmplt_ps(dist, neg_r));
+		}
+
+		const int mask = ~_mm_movemask_ps(outside) & 0xF;
+		for (int lane = 0; lane < 4; lane++) {
+			if (mask & (1 << lane))
+				visible.push_back((uint32_t)(i + lane));
+		}
+	}
+
+	for (; i < count; i++) {
+		if (test_sphere(glm::vec3(spheres[i]), spheres[i].w))
+			visible.push_back((uint32_t)i);
+	}
+}
+
+float renderer::frustum::get_projected_radius(const glm::vec3& center, float radius, float viewport_height) const {
+	const float w = glm::dot(glm::vec3(w_row_), center) + w_row_.w;
+	if (w <= 0.f)
+		return std::numeric_limits<float>::infinity();
+
+	return radius * y_scale_ / w * viewport_height * 0.5f;
+}
@@ -0,0 +1,207 @@
+#include "renderer/util/job_system.hpp"
+
+namespace {
+	thread_local const renderer::job_system* current_pool = nullptr;
+	thread_local size_t current_worker = renderer::job_system::any_worker;
+
+	// Yields before going to sleep, most waits on small jobs are over before a wake would even arrive
+	constexpr size_t spin_count = 64;
+}// namespace
+
+renderer::job_system::job_system(size_t worker_count) {
+	workers_.reserve(worker_count);
+	for (size_t i = 0; i < worker_count; i++)
+		workers_.push_back(std::make_unique<worker>());
+
+	// Started once every worker exists so stealing never sees a half filled list
+	for (size_t i = 0; i < worker_count; i++)
+		workers_[i]->thread = std::thread(&job_system::worker_loop, this, i);
+}
+
+renderer::job_system::~job_system() {
+	{
+		std::lock_guard lock(sleep_mutex_);
+		stopping_ = true;
+	}
+
+	sleep_condition_.notify_all();
+	for (auto& worker : workers_)
+		worker->thread.join();
+}
+
+renderer::job_system& renderer::job_system::get_default() {
+	static job_system pool;
+	return pool;
+}
+
+size_t renderer::job_system::get_worker_index() const {
+	return current_pool == this ? current_worker : any_worker;
+}
+
+void renderer::job_system::submit(job_group& group, job&& fn, size_t worker_index) {
+	group.pending_.fetch_add(1, std::memory_order_relaxed);
+	task new_task{ std::move(fn), &group };
+
+	if (workers_.empty()) {
+		run(new_task);
+		return;
+	}
+
+	if (worker_index != any_worker) {
+		worker& target = *workers_[worker_index % workers_.size()];
+		{
+			std::lock_guard lock(target.mutex);
+			target.pinned.push_back(std::move(new_task));
+		}
+
+		target.pinned_count.fetch_add(1);
+		wake(true);
+		return;
+	}
+
+	if (const size_t self = get_worker_index(); self != any_worker) {
+		std::lock_guard lock(workers_[self]->mutex);
+		workers_[self]->tasks.push_back(std::move(new_task));
+	}
+	else {
+		std::lock_guard lock(injected_mutex_);
+		injected_.push_back(std::move(new_task));
+	}
+
+	queued_.fetch_add(1);
+	wake(false);
+}
+
+void renderer::job_system::wait(job_group& group) {
+	const size_t self = get_worker_index();
+
+	for (size_t idle = 0; !group.done();) {
+		if (try_run_one()) {
+			idle = 0;
+			continue;
+		}
+
+		if (++idle < spin_count) {
+			std::this_thread::yield();
+			continue;
+		}
+
+		std::unique_lock lock(sleep_mutex_);
+		sleeping_.fetch_add(1);
+		sleep_condition_.wait(lock, [&] { return group.done() || has_work_for(self); });
+		sleeping_.fetch_sub(1);
+		idle = 0;
+	}
+}
+
+bool renderer::job_system::has_work_for(size_t index) const {
+	if (queued_.load() > 0)
+		return true;
+
+	return index != any_worker && workers_[index]->pinned_count.load() > 0;
+}
+
+void renderer::job_system::wake(bool all) {
+	if (sleeping_.load() == 0)
+		return;
+
+	// Taking the lock orders the wake after a sleeper's check of its predicate
+	{ std::lock_guard lock(sleep_mutex_); }
+
+	if (all)
+		sleep_condition_.notify_all();
+	else
+		sleep_condition_.notify_one();
+}
+
+void renderer::job_system::run(task& task) {
+	task.fn();
+	task.fn = nullptr;
+
+	// The group may be gone as soon as its count hits zero, only the pool is touched after that
+	if (task.group->pending_.fetch_sub(1) == 1)
+		wake(true);
+}
+
+bool renderer::job_system::try_pop(size_t index, task& out) {
+	worker& self = *workers_[index];
+	std::lock_guard lock(self.mutex);
+
+	if (!self.pinned.empty()) {
+		out = std::move(self.pinned.front());
+		self.pinned.pop_front();
+		self.pinned_count.fetch_sub(1);
+		return true;
+	}
+
+	// Newest first, it's the one most likely still in cache
+	if (!self.tasks.empty()) {
+		out = std::move(self.tasks.back());
+		self.tasks.pop_back();
+		queued_.fetch_sub(1);
+		return true;
+	}
+
+	return false;
+}
+
+bool renderer::job_system::try_steal(size_t index, task& out) {
+	{
+		std::lock_guard lock(injected_mutex_);
+		if (!injected_.empty()) {
+			out = std::move(injected_.front());
+			injected_.pop_front();
+			queued_.fetch_sub(1);
+			return true;
+		}
+	}
+
+	// Oldest first, those are the biggest pieces of split ranges
+	const size_t start = index == any_worker ? 0 : index + 1;
+	for (size_t i = 0; i < workers_.size(); i++) {
+		const size_t victim_index = (start + i) % workers_.size();
+		if (victim_index == index)
+			continue;
+
+		worker& victim = *workers_[victim_index];
+		std::lock_guard lock(victim.mutex);
+		if (!victim.tasks.empty()) {
+			out = std::move(victim.tasks.front());
+			victim.tasks.pop_front();
+			queued_.fetch_sub(1);
+			return true;
+		}
+	}
+
+	return false;
+}
+
+bool renderer::job_system::try_run_one() {
+	const size_t self = get_worker_index();
+
+	task found;
+	if ((self != any_worker && try_pop(self, found)) || try_steal(self, found)) {
+		run(found);
+		return true;
+	}
+
+	return false;
+}
+
+void renderer::job_system::worker_loop(size_t index) {
+	current_pool = this;
+	current_worker = index;
+
+	while (true) {
+		if (try_run_one())
+			continue;
+
+		std::unique_lock lock(sleep_mutex_);
+		sleeping_.fetch_add(1);
+		sleep_condition_.wait(lock, [&] { return stopping_ || has_work_for(index); });
+		sleeping_.fetch_sub(1);
+
+		if (stopping_ && !has_work_for(index))
+			return;
+	}
+}
@@ -0,0 +1,90 @@
+#include "renderer/util/mapped_file.hpp"
+
+#include <string>
+#include <utility>
+
+renderer::mapped_file::mapped_file(std::string_view filename) {
+	open(filename);
+}
+
+renderer::mapped_file::mapped_file(mapped_file&& other) noexcept :
+	file_(std::exchange(other.file_, INVALID_HANDLE_VALUE)),
+	mapping_(std::exchange(other.mapping_, nullptr)),
+	data_(std::exchange(other.data_, nullptr)),
+	size_(std::exchange(other.size_, 0)),
+	last_write_time_(std::exchange(other.last_write_time_, 0)) {}
+
+renderer::mapped_file& renderer::mapped_file::operator=(mapped_file&& other) noexcept {
+	if (this != &other) {
+		close();
+
+		file_ = std::exchange(other.file_, INVALID_HANDLE_VALUE);
+		mapping_ = std::exchange(other.mapping_, nullptr);
+		data_ = std::exchange(other.data_, nullptr);
+		size_ = std::exchange(other.size_, 0);
+		last_write_time_ = std::exchange(other.last_write_time_, 0);
+	}
+
+	return *this;
+}
+
+renderer::mapped_file::~mapped_file() {
+	close();
+}
+
+bool renderer::mapped_file::open(std::string_view filename) {
+	close();
+
+	// string_view is not guaranteed to be null terminated
+	const std::string path(filename);
+
+	file_ = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+						FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if (file_ == INVALID_HANDLE_VALUE)
+		return false;
+
+	LARGE_INTEGER file_size{};
+	if (!GetFileSizeEx(file_, &file_size) || file_size.QuadPart == 0) {
+		close();
+		return false;
+	}
+
+	mapping_ = CreateFileMappingA(file_, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (!mapping_) {
+		close();
+		return false;
+	}
+
+	data_ = static_cast<const uint8_t*>(MapViewOfFile(mapping_, FILE_MAP_READ, 0, 0, 0));
+	if (!data_) {
+		close();
+		return false;
+	}
+
+	FILETIME write_time{};
+	if (GetFileTime(file_, nullptr, nullptr, &write_time))
+		last_write_time_ = (uint64_t)write_time.dwHighDateTime << 32 | write_time.dwLowDateTime;
+
+	size_ = static_cast<size_t>(file_size.QuadPart);
+	return true;
+}
+
+void renderer::mapped_file::close() {
+	if (data_) {
+		UnmapViewOfFile(data_);
+		data_ = nullptr;
+	}
+
+	if (mapping_) {
+		CloseHandle(mapping_);
+		mapping_ = nullptr;
+	}
+
+	if (file_ != INVALID_HANDLE_VALUE) {
+		CloseHandle(file_);
+		file_ = INVALID_HANDLE_VALUE;
+	}
+
+	size_ = 0;
+	last_write_time_ = 0;
+}
@@ -0,0 +1,148 @@
+#include "renderer/util/rect_packer.hpp"
+
+#include <algorithm>
+#include <limits>
+#include <numeric>
+
+std::unique_ptr<renderer::rect_packer> renderer::rect_packer::create(rect_packer_type type) {
+	switch (type) {
+		case skyline_best_fit:
+			return std::make_unique<skyline_packer>(STBRP_HEURISTIC_Skyline_BF_sortHeight);
+		case max_rects_best_short_side:
+			return std::make_unique<max_rects_packer>();
+		case skyline_bottom_left:
+		default:
+			return std::make_unique<skyline_packer>(STBRP_HEURISTIC_Skyline_BL_sortHeight);
+	}
+}
+
+void renderer::skyline_packer::init(int width, int height) {
+	nodes_.resize(width);
+	stbrp_init_target(&context_, width, height, nodes_.data(), (int)nodes_.size());
+	stbrp_setup_heuristic(&context_, heuristic_);
+}
+
+bool renderer::skyline_packer::pack(stbrp_rect* rects, int count) {
+	return stbrp_pack_rects(&context_, rects, count) != 0;
+}
+
+void renderer::max_rects_packer::init(int width, int height) {
+	free_rects_.clear();
+	free_rects_.push_back({ 0, 0, width, height });
+	used_height_ = 0;
+}
+
+bool renderer::max_rects_packer::pack(stbrp_rect* rects, int count) {
+	// Biggest first, small glyphs fill the gaps left behind
+	std::vector<int> order(count);
+	std::iota(order.begin(), order.end(), 0);
+	std::ranges::sort(order, [rects](int lhs, int rhs) {
+		const stbrp_rect& a = rects[lhs];
+		const stbrp_rect& b = rects[rhs];
+		const int a_max = std::max(a.w, a.h), b_max = std::max(b.w, b.h);
+		if (a_max != b_max)
+			return a_max > b_max;
+
+		return std::min(a.w, a.h) > std::min(b.w, b.h);
+	});
+
+	bool all_packed = true;
+	for (int i : order) {
+		stbrp_rect& rect = rects[i];
+		if (rect.w == 0 || rect.h == 0) {
+			rect.x = rect.y = 0;
+			rect.was_packed = 1;
+			continue;
+		}
+
+		// The atlas height is cropped to what was used, so placements that grow it lose to any that don't. Free rects
+		// are clipped to the used height as well, otherwise the open space below would always be the best fit
+		const free_rect* best = nullptr;
+		int best_growth = std::numeric_limits<int>::max();
+		int best_short = std::numeric_limits<int>::max(), best_long = std::numeric_limits<int>::max();
+		for (const free_rect& free : free_rects_) {
+			if (rect.w > free.w || rect.h > free.h)
+				continue;
+
+			const int bottom = free.y + rect.h;
+			const int growth = std::max(bottom - used_height_, 0);
+			const int leftover_w = free.w - rect.w;
+			const int leftover_h = std::min(free.y + free.h, std::max(used_height_, bottom)) - bottom;
+			const int short_side = std::min(leftover_w, leftover_h), long_side = std::max(leftover_w, leftover_h);
+			if (growth < best_growth || (growth == best_growth && short_side < best_short) ||
+				(growth == best_growth && short_side == best_short && long_side < best_long)) {
+				best = &free;
+				best_growth = growth;
+				best_short = short_side;
+				best_long = long_side;
+			}
+		}
+
+		if (!best) {
+			rect.was_packed = 0;
+			all_packed = false;
+			continue;
+		}
+
+		rect.x = best->x;
+		rect.y = best->y;
+		rect.was_packed = 1;
+		used_height_ = std::max(used_height_, rect.y + rect.h);
+		place({ rect.x, rect.y, rect.w, rect.h });
+	}
+
+	return all_packed;
+}
+
+void renderer::max_rects_packer::place(const free_rect& used) {
+	new_free_rects_.clear();
+
+	// Split every free rect the used area overlaps into up to four maximal rects around it
+	for (size_t i = 0; i < free_rects_.size();) {
+		const free_rect free = free_rects_[i];
+		if (used.x >= free.x + free.w || used.x + used.w <= free.x || used.y >= free.y + free.h ||
+			used.y + used.h <= free.y) {
+			i++;
+			continue;
+		}
+
+		if (used.x > free.x)
+			new_free_rects_.push_back({ free.x, free.y, used.x - free.x, free.h });
+		if (used.x + used.w < free.x + free.w)
+			new_free_rects_.push_back({ used.x + used.w, free.y, free.x + free.w - (used.x + used.w), free.h });
+		if (used.y > free.y)
+			new_free_rects_.push_back({ free.x, free.y, free.w, used.y - free.y });
+		if (used.y + used.h < free.y + free.h)
+			new_free_rects_.push_back({ free.x, used.y + used.h, free.w, free.y + free.h - (used.y + used.h) });
+
+		free_rects_[i] = free_rects_.back();
+		free_rects_.pop_back();
+	}
+
+	const auto contains = [](const free_rect& outer, const free_rect& inner) {
+		return inner.x >= outer.x && inner.y >= outer.y && inner.x + inner.w <= outer.x + outer.w &&
+			   inner.y + inner.h <= outer.y + outer.h;
+	};
+
+	// The untouched free rects are already maximal, so only the new ones have to be checked against everything
+	std::vector<bool> removed(new_free_rects_.size(), false);
+	for (size_t i = 0; i < new_free_rects_.size(); i++) {
+		const free_rect& candidate = new_free_rects_[i];
+		if (std::ranges::any_of(free_rects_, [&](const free_rect& free) { return contains(free, candidate); })) {
+			removed[i] = true;
+			continue;
+		}
+
+		for (size_t j = 0; j < new_free_rects_.size(); j++) {
+			if (i != j && !removed[j] && contains(new_free_rects_[j], candidate)) {
+				removed[i] = true;
+				break;
+			}
+		}
+	}
+
+	for (size_t i = 0; i < new_free_rects_.size(); i++) {
+		if (!removed[i])
+			free_rects_.push_back(new_free_rects_[i]);
+	}
+}
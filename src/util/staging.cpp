@@ -0,0 +1,51 @@
+#include "renderer/util/staging.hpp"
+
+#include "renderer/util/job_system.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+renderer::staging_totals renderer::plan_staging(std::span<staging_chunk> chunks, staging_totals base) {
+	staging_totals totals = base;
+	for (staging_chunk& chunk : chunks) {
+		chunk.vertices_offset = totals.vertices_size;
+		chunk.indices_offset = totals.indices_size;
+		totals.vertices_size += chunk.vertices_size;
+		totals.indices_size += chunk.indices_size;
+	}
+
+	return totals;
+}
+
+void renderer::staging_copier::add_slices(std::byte* dst, const void* src, size_t size) {
+	const auto* src_bytes = static_cast<const std::byte*>(src);
+	for (size_t offset = 0; offset < size; offset += slice_size)
+		slices_.push_back({ dst + offset, src_bytes + offset, std::min(slice_size, size - offset) });
+}
+
+void renderer::staging_copier::copy(std::span<const staging_chunk> chunks, void* vertices_dst, void* indices_dst) {
+	slices_.clear();
+
+	size_t total_size = 0;
+	for (const staging_chunk& chunk : chunks) {
+		if (chunk.vertices_size)
+			add_slices(static_cast<std::byte*>(vertices_dst) + chunk.vertices_offset, chunk.vertices,
+					   chunk.vertices_size);
+		if (chunk.indices_size)
+			add_slices(static_cast<std::byte*>(indices_dst) + chunk.indices_offset, chunk.indices, chunk.indices_size);
+
+		total_size += chunk.vertices_size + chunk.indices_size;
+	}
+
+	const auto copy_slice = [](const slice& slice) { memcpy(slice.dst, slice.src, slice.size); };
+
+	// Waking workers costs more than copying a small frame
+	if (total_size < parallel_threshold) {
+		std::for_each(slices_.begin(), slices_.end(), copy_slice);
+		return;
+	}
+
+	job_system::get_default().parallel_for(0, slices_.size(), 1, [this, &copy_slice](size_t first, size_t last) {
+		std::for_each(slices_.begin() + first, slices_.begin() + last, copy_slice);
+	});
+}
@@ -0,0 +1,186 @@
+#include <renderer/renderer.hpp>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// Producers swapping their slot while a render thread keeps taking frames, once through buffer_node's triple
+// buffered hand-off and once through the old double buffered swap under the renderer wide buffer list mutex. Slots
+// are left without buffers, the frame contents live in a payload per buffer index instead
+namespace {
+	constexpr auto run_time = std::chrono::milliseconds(500);
+	constexpr size_t frame_size = 4096;
+
+	struct frames {
+		std::array<std::vector<uint32_t>, 3> payload;
+
+		frames() {
+			for (auto& contents : payload)
+				contents.resize(frame_size);
+		}
+	};
+
+	struct result {
+		uint64_t frames_published = 0;
+		uint64_t frames_presented = 0;
+		double mean_swap_ns = 0.0;
+		double max_swap_ns = 0.0;
+	};
+
+	void fill(std::vector<uint32_t>& contents, uint32_t frame) {
+		std::ranges::fill(contents, frame);
+	}
+
+	uint64_t read(const std::vector<uint32_t>& contents) {
+		uint64_t sum = 0;
+		for (const uint32_t value : contents)
+			sum += value;
+		return sum;
+	}
+
+	// Runs one producer per slot and the render thread on the calling thread until run_time is up
+	template<typename swap_t, typename render_t>
+	result run(size_t producers, swap_t&& swap, render_t&& render) {
+		std::atomic<bool> stop = false;
+		std::vector<uint64_t> published(producers), swap_ns(producers), max_ns(producers);
+
+		std::vector<std::thread> threads;
+		for (size_t i = 0; i < producers; i++) {
+			threads.emplace_back([&, i] {
+				for (uint32_t frame = 1; !stop.load(std::memory_order_relaxed); frame++) {
+					const auto start = std::chrono::steady_clock::now();
+					swap(i, frame);
+					const auto elapsed =
+					(uint64_t)std::chrono::nanoseconds(std::chrono::steady_clock::now() - start).count();
+
+					published[i]++;
+					swap_ns[i] += elapsed;
+					max_ns[i] = std::max(max_ns[i], elapsed);
+				}
+			});
+		}
+
+		uint64_t presented = 0;
+		for (const auto end = std::chrono::steady_clock::now() + run_time; std::chrono::steady_clock::now() < end;)
+			presented += render();
+
+		stop = true;
+		for (std::thread& thread : threads)
+			thread.join();
+
+		result out{ .frames_presented = presented };
+		for (size_t i = 0; i < producers; i++) {
+			out.frames_published += published[i];
+			out.mean_swap_ns += (double)swap_ns[i];
+			out.max_swap_ns = std::max(out.max_swap_ns, (double)max_ns[i]);
+		}
+
+		out.mean_swap_ns /= (double)std::max<uint64_t>(out.frames_published, 1);
+		return out;
+	}
+
+	result run_triple_buffered(size_t producers) {
+		std::vector<std::unique_ptr<renderer::buffer_node>> nodes;
+		std::vector<frames> contents(producers);
+		for (size_t i = 0; i < producers; i++)
+			nodes.push_back(std::make_unique<renderer::buffer_node>());
+
+		uint64_t sink = 0;
+		result out = run(
+		producers,
+		[&](size_t i, uint32_t frame) {
+			renderer::buffer_node& node = *nodes[i];
+			fill(contents[i].payload[node.working], frame);
+			node.publish();
+		},
+		[&] {
+			uint64_t presented = 0;
+			for (size_t i = 0; i < producers; i++) {
+				renderer::buffer_node& node = *nodes[i];
+				presented += node.acquire();
+				sink += read(contents[i].payload[node.active]);
+			}
+			return presented;
+		});
+
+		return sink ? out : result{};
+	}
+
+	// The pre triple buffering layout, swap_buffers and render() both held the buffer list mutex exclusively
+	result run_mutex(size_t producers) {
+		struct slot {
+			std::unique_ptr<std::vector<uint32_t>> active = std::make_unique<std::vector<uint32_t>>(frame_size);
+			std::unique_ptr<std::vector<uint32_t>> working = std::make_unique<std::vector<uint32_t>>(frame_size);
+			bool fresh = false;
+		};
+
+		std::shared_mutex buffer_list_mutex;
+		std::vector<slot> slots(producers);
+
+		uint64_t sink = 0;
+		result out = run(
+		producers,
+		[&](size_t i, uint32_t frame) {
+			{
+				std::shared_lock lock(buffer_list_mutex);
+				fill(*slots[i].working, frame);
+			}
+
+			std::unique_lock lock(buffer_list_mutex);
+			slots[i].active.swap(slots[i].working);
+			slots[i].fresh = true;
+		},
+		[&] {
+			std::unique_lock lock(buffer_list_mutex);
+
+			uint64_t presented = 0;
+			for (slot& slot : slots) {
+				presented += std::exchange(slot.fresh, false);
+				sink += read(*slot.active);
+			}
+			return presented;
+		});
+
+		return sink ? out : result{};
+	}
+
+	void print(const char* name, size_t producers, const result& result) {
+		const double seconds = std::chrono::duration<double>(run_time).count();
+		std::printf("%-8s %9zu %14.0f %14.0f %12.0f %12.0f\n",
+					name,
+					producers,
+					(double)result.frames_published / seconds,
+					(double)result.frames_presented / seconds,
+					result.mean_swap_ns,
+					result.max_swap_ns);
+	}
+}// namespace
+
+int main() {
+	std::printf("hardware threads: %u, %zu uint32 per frame, %lld ms per run\n",
+				std::thread::hardware_concurrency(),
+				frame_size,
+				(long long)run_time.count());
+	std::printf("%-8s %9s %14s %14s %12s %12s\n",
+				"path",
+				"producers",
+				"published/s",
+				"presented/s",
+				"mean swap ns",
+				"max swap ns");
+
+	for (const size_t producers : { 1, 4, 16, 40 }) {
+		print("triple", producers, run_triple_buffered(producers));
+		print("mutex", producers, run_mutex(producers));
+	}
+
+	return 0;
+}
@@ -0,0 +1,117 @@
+#include <renderer/font.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+// Glyph lookups through the paged font_lookup_table against the dense table it replaced, one entry per codepoint up
+// to the highest one. Both are filled with the default glyph ranges plus the emoji block so the dense one pays for a
+// large max codepoint like a font with emoji fallback does
+namespace {
+	using lookup_table = renderer::text_font::font_lookup_table;
+
+	constexpr size_t lookups = 1 << 22;
+	constexpr size_t repetitions = 5;
+	constexpr uint32_t emoji_first = 0x1F600, emoji_last = 0x1F64F;
+
+	struct dense_table {
+		std::vector<float> advances_x{};
+		std::vector<uint32_t> indexes{};
+
+		void set(uint32_t c, float advance_x, uint32_t index) {
+			if (c >= indexes.size()) {
+				advances_x.resize(c + 1, -1.0f);
+				indexes.resize(c + 1, lookup_table::empty_index);
+			}
+
+			advances_x[c] = advance_x;
+			indexes[c] = index;
+		}
+
+		[[nodiscard]] uint32_t find(uint32_t c) const {
+			return c < indexes.size() ? indexes[c] : lookup_table::empty_index;
+		}
+	};
+
+	struct text_mix {
+		const char* name;
+		std::vector<uint32_t> codepoints;
+	};
+
+	// Codepoints drawn uniformly from the given ranges
+	std::vector<uint32_t> make_text(std::initializer_list<std::pair<uint32_t, uint32_t>> ranges) {
+		std::vector<uint32_t> pool;
+		for (const auto& [first, last] : ranges) {
+			for (uint32_t c = first; c <= last; c++)
+				pool.push_back(c);
+		}
+
+		std::mt19937 random(1234);
+		std::uniform_int_distribution<size_t> pick(0, pool.size() - 1);
+
+		std::vector<uint32_t> text(lookups);
+		for (uint32_t& c : text)
+			c = pool[pick(random)];
+		return text;
+	}
+
+	// Median nanoseconds per lookup
+	template<typename find_t>
+	double measure(const std::vector<uint32_t>& text, find_t&& find, uint64_t& sink) {
+		std::vector<double> samples;
+		for (size_t i = 0; i < repetitions; i++) {
+			const auto start = std::chrono::steady_clock::now();
+			for (const uint32_t c : text)
+				sink += find(c);
+			const auto end = std::chrono::steady_clock::now();
+			samples.push_back(std::chrono::duration<double, std::nano>(end - start).count() / (double)text.size());
+		}
+
+		std::ranges::sort(samples);
+		return samples[samples.size() / 2];
+	}
+}// namespace
+
+int main() {
+	lookup_table paged;
+	dense_table dense;
+
+	uint32_t index = 0;
+	const uint32_t* ranges = renderer::text_font::glyph::ranges_default();
+	for (; ranges[0]; ranges += 2) {
+		for (uint32_t c = ranges[0]; c <= ranges[1]; c++, index++) {
+			paged.set(c, 8.0f, index);
+			dense.set(c, 8.0f, index);
+		}
+	}
+
+	for (uint32_t c = emoji_first; c <= emoji_last; c++, index++) {
+		paged.set(c, 16.0f, index);
+		dense.set(c, 16.0f, index);
+	}
+
+	const size_t paged_bytes = paged.pages.size() * sizeof(uint16_t) + paged.advances_x.size() * sizeof(float) +
+							   paged.indexes.size() * sizeof(uint32_t);
+	const size_t dense_bytes = dense.advances_x.size() * sizeof(float) + dense.indexes.size() * sizeof(uint32_t);
+	std::printf("%u glyphs, paged table %zu KiB, dense table %zu KiB\n", index, paged_bytes >> 10, dense_bytes >> 10);
+
+	const text_mix mixes[] = {
+		{ "ascii", make_text({ { 0x20, 0x7E } }) },
+		{ "latin+cyrillic", make_text({ { 0x20, 0x24F }, { 0x400, 0x52F } }) },
+		{ "with emoji", make_text({ { 0x20, 0x7E }, { emoji_first, emoji_last } }) },
+		{ "cjk misses", make_text({ { 0x20, 0x7E }, { 0x4E00, 0x9FFF } }) },
+	};
+
+	uint64_t sink = 0;
+	std::printf("%-16s %12s %12s\n", "text", "paged ns", "dense ns");
+	for (const text_mix& mix : mixes) {
+		const double paged_ns =
+		measure(mix.codepoints, [&](uint32_t c) { return paged.indexes[paged.get_slot(c)]; }, sink);
+		const double dense_ns = measure(mix.codepoints, [&](uint32_t c) { return dense.find(c); }, sink);
+		std::printf("%-16s %12.2f %12.2f\n", mix.name, paged_ns, dense_ns);
+	}
+
+	return sink == 0;
+}
@@ -0,0 +1,170 @@
+#include <renderer/util/job_system.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Small task overhead of the work stealing pool against a pool sharing one locked queue, at 8 to 64 threads
+// counting the caller. Jobs do next to nothing so the numbers are scheduling cost only
+namespace {
+	constexpr size_t repetitions = 5;
+	constexpr size_t submit_jobs = 100000;
+	constexpr size_t range_size = 1 << 20;
+	constexpr size_t range_grain = 256;
+	constexpr int fork_depth = 16;
+
+	// Every worker pops from the same deque, the obvious pool to beat
+	class shared_queue_pool {
+	public:
+		explicit shared_queue_pool(size_t worker_count) {
+			for (size_t i = 0; i < worker_count; i++)
+				threads_.emplace_back([this] { worker_loop(); });
+		}
+
+		~shared_queue_pool() {
+			{
+				std::lock_guard lock(mutex_);
+				stopping_ = true;
+			}
+
+			condition_.notify_all();
+			for (std::thread& thread : threads_)
+				thread.join();
+		}
+
+		void submit(std::function<void()>&& fn) {
+			pending_.fetch_add(1, std::memory_order_relaxed);
+			{
+				std::lock_guard lock(mutex_);
+				tasks_.push_back(std::move(fn));
+			}
+
+			condition_.notify_one();
+		}
+
+		void wait() {
+			while (pending_.load() != 0) {
+				std::function<void()> fn;
+				{
+					std::lock_guard lock(mutex_);
+					if (!tasks_.empty()) {
+						fn = std::move(tasks_.front());
+						tasks_.pop_front();
+					}
+				}
+
+				if (fn)
+					run(fn);
+				else
+					std::this_thread::yield();
+			}
+		}
+
+	private:
+		std::vector<std::thread> threads_;
+		std::mutex mutex_;
+		std::condition_variable condition_;
+		std::deque<std::function<void()>> tasks_;
+		std::atomic<size_t> pending_ = 0;
+		bool stopping_ = false;
+
+		void run(std::function<void()>& fn) {
+			fn();
+			pending_.fetch_sub(1);
+		}
+
+		void worker_loop() {
+			while (true) {
+				std::function<void()> fn;
+				{
+					std::unique_lock lock(mutex_);
+					condition_.wait(lock, [this] { return stopping_ || !tasks_.empty(); });
+					if (stopping_ && tasks_.empty())
+						return;
+
+					fn = std::move(tasks_.front());
+					tasks_.pop_front();
+				}
+
+				run(fn);
+			}
+		}
+	};
+
+	// Median nanoseconds per item over the repetitions
+	template<typename fn_t>
+	double measure(size_t items, fn_t&& fn) {
+		std::vector<double> samples;
+		for (size_t i = 0; i < repetitions; i++) {
+			const auto start = std::chrono::steady_clock::now();
+			fn();
+			const auto end = std::chrono::steady_clock::now();
+			samples.push_back(std::chrono::duration<double, std::nano>(end - start).count() / (double)items);
+		}
+
+		std::ranges::sort(samples);
+		return samples[samples.size() / 2];
+	}
+
+	void fork(renderer::job_system& pool, int depth, std::atomic<size_t>& leaves) {
+		if (depth == 0) {
+			leaves.fetch_add(1, std::memory_order_relaxed);
+			return;
+		}
+
+		pool.invoke([&] { fork(pool, depth - 1, leaves); }, [&] { fork(pool, depth - 1, leaves); });
+	}
+}// namespace
+
+int main() {
+	std::printf("hardware threads: %u\n", std::thread::hardware_concurrency());
+	std::printf(
+	"%8s %14s %14s %14s %14s\n", "threads", "submit ns/job", "shared ns/job", "for ns/chunk", "fork ns/join");
+
+	std::atomic<size_t> sink = 0;
+	for (const size_t threads : { 8, 16, 32, 64 }) {
+		renderer::job_system pool(threads - 1);
+
+		const double submit = measure(submit_jobs, [&] {
+			renderer::job_group group;
+			for (size_t i = 0; i < submit_jobs; i++)
+				pool.submit(group, [&sink] { sink.fetch_add(1, std::memory_order_relaxed); });
+			pool.wait(group);
+		});
+
+		const double range = measure(range_size / range_grain, [&] {
+			pool.parallel_for(0, range_size, range_grain, [&sink](size_t first, size_t last) {
+				size_t sum = 0;
+				for (size_t i = first; i < last; i++)
+					sum += i;
+				sink.fetch_add(sum, std::memory_order_relaxed);
+			});
+		});
+
+		const double joins = measure((size_t(1) << fork_depth) - 1, [&] {
+			std::atomic<size_t> leaves = 0;
+			fork(pool, fork_depth, leaves);
+		});
+
+		double shared;
+		{
+			shared_queue_pool baseline(threads - 1);
+			shared = measure(submit_jobs, [&] {
+				for (size_t i = 0; i < submit_jobs; i++)
+					baseline.submit([&sink] { sink.fetch_add(1, std::memory_order_relaxed); });
+				baseline.wait();
+			});
+		}
+
+		std::printf("%8zu %14.1f %14.1f %14.1f %14.1f\n", threads, submit, shared, range, joins);
+	}
+
+	return sink.load() == 0;
+}
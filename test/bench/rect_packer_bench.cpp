@@ -0,0 +1,81 @@
+#include <renderer/font.hpp>
+
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Builds the same atlas with every rect packer over the default glyph ranges and prints the pages it took, how full
+// they are and how long packing and the whole build took. Fonts are taken from the command line, Tahoma otherwise
+namespace {
+	struct packer_info {
+		renderer::rect_packer_type type;
+		const char* name;
+	};
+
+	constexpr packer_info packers[] = {
+		{ renderer::skyline_bottom_left, "skyline_bottom_left" },
+		{ renderer::skyline_best_fit, "skyline_best_fit" },
+		{ renderer::max_rects_best_short_side, "max_rects_bssf" },
+	};
+
+	constexpr float sizes[] = { 13.f, 18.f, 32.f, 64.f };
+	constexpr int page_sizes[] = { 1024, 4096 };
+
+	void add_fonts(renderer::font_atlas& atlas, const std::vector<std::string>& files) {
+		for (const float size : sizes) {
+			renderer::text_font::font_config config{ .size_pixels = size };
+			if (files.empty()) {
+				atlas.add_font_default(&config);
+				continue;
+			}
+
+			for (const std::string& file : files)
+				atlas.add_font_from_file_ttf(file, size, &config);
+		}
+	}
+}// namespace
+
+int main(int argc, char** argv) {
+	const std::vector<std::string> files(argv + 1, argv + argc);
+
+	std::printf("%-20s %6s %6s %8s %8s %10s %9s %9s\n",
+				"packer",
+				"page",
+				"pages",
+				"packed",
+				"dropped",
+				"occupancy",
+				"pack ms",
+				"build ms");
+
+	for (const int page_size : page_sizes) {
+		for (const packer_info& packer : packers) {
+			auto atlas = std::make_unique<renderer::font_atlas>();
+			atlas->texture.packer = packer.type;
+			atlas->texture.max_page_size = page_size;
+			// Cropped pages so occupancy reflects the packer rather than the power of two rounding
+			atlas->texture.tight_pages = true;
+			add_fonts(*atlas, files);
+
+			const auto start = std::chrono::steady_clock::now();
+			atlas->build();
+			const double build_ms =
+			std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+			const renderer::font_atlas::atlas_stats& stats = atlas->stats;
+			std::printf("%-20s %6d %6zu %8zu %8zu %9.1f%% %9.2f %9.2f\n",
+						packer.name,
+						page_size,
+						stats.pages,
+						stats.glyphs_packed,
+						stats.glyphs_dropped,
+						stats.get_occupancy(),
+						stats.pack_time_ms,
+						build_ms);
+		}
+	}
+
+	return 0;
+}
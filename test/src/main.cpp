@@ -147,7 +147,7 @@ void draw_test_primitives(renderer::buffer* buf) {
 	}*/
 
 	// TODO: Fix calc text size
-    const auto size = seguiemj->calc_text_size(demo_string);
+    const auto size = buf->get_font(seguiemj)->calc_text_size(demo_string);
 	buf->draw_rect({300.0f, 300.0f}, {300.0f + size.x, 300.0f + size.y}, COLOR_RED);
 }
 
@@ -158,7 +158,6 @@ void draw_thread() {
 	while (!close_requested) {
 		//updated_draw.wait();
 
-		renderer::atlas.locked = true;
 		set_default_font(renderer::get_default_font());
 
 		auto buf = dx11->get_working_buffer(id);
@@ -171,15 +170,12 @@ void draw_thread() {
 
         swap_counter.tick();
 
-		renderer::atlas.locked = false;
-
 		//updated_buf.notify();
 	}
 }
 
 void draw_rect_thread(size_t buffer_id, glm::vec2 start, glm::vec2 end, const renderer::color_rgba& color) {
     while (!close_requested) {
-        renderer::atlas.locked = true;
         set_default_font(renderer::get_default_font());
 
         auto buf = dx11->get_working_buffer(buffer_id);
@@ -189,12 +185,9 @@ void draw_rect_thread(size_t buffer_id, glm::vec2 start, glm::vec2 end, const re
 
         dx11->swap_buffers(buffer_id);
         swap_counter.tick();
-
-        renderer::atlas.locked = false;
     }
 }
 
-// TODO: Mutex for texture creation and atlas
 int main() {
 #if _DEBUG
 	// if (GetConsoleWindow() == nullptr) {
@@ -247,6 +240,8 @@ int main() {
 
 	seguiemj = renderer::atlas.add_font_from_file_ttf(std::string(csidl_fonts) + '\\' + "seguiemj.ttf", 32.f, &config);
 	renderer::atlas.add_font_from_file_ttf(std::string(csidl_fonts) + '\\' + "seguiemj.ttf", 64.f, &config);
+	tahoma->add_fallback_font(seguiemj);
+	renderer::atlas.cache_filename = "font_atlas.cache";
     dx11->create_atlases();
 
 	application->set_visibility(true);
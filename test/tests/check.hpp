@@ -0,0 +1,26 @@
+#ifndef RENDERER_TEST_CHECK_HPP
+#define RENDERER_TEST_CHECK_HPP
+
+#include <cstdio>
+
+// Tests are plain executables, a failed check is printed and counted and main returns check_result()
+namespace renderer::test {
+	inline int failures = 0;
+
+	inline int check_result() {
+		if (failures)
+			std::printf("%d check(s) failed\n", failures);
+
+		return failures ? 1 : 0;
+	}
+}// namespace renderer::test
+
+#define CHECK(EXPR) \
+	do { \
+		if (!(EXPR)) { \
+			std::printf("%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #EXPR); \
+			renderer::test::failures++; \
+		} \
+	} while (false)
+
+#endif
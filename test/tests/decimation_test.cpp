@@ -0,0 +1,277 @@
+#include "check.hpp"
+
+#include <renderer/util/decimation.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <random>
+#include <vector>
+
+// decimate_min_max keeps every column's extremes and decimate_rdp stays within its tolerance, checked on random
+// series against a brute force over the input
+namespace {
+	bool same(const glm::vec2& a, const glm::vec2& b) {
+		return a.x == b.x && a.y == b.y;
+	}
+
+	bool same(const std::vector<glm::vec2>& a, const std::vector<glm::vec2>& b) {
+		return std::ranges::equal(a, b, [](const glm::vec2& l, const glm::vec2& r) { return same(l, r); });
+	}
+
+	// Input index of every output point, empty when the output isn't an ordered subset of the input
+	std::vector<size_t> match_indices(const std::vector<glm::vec2>& points, const std::vector<glm::vec2>& out) {
+		std::vector<size_t> indices;
+		size_t i = 0;
+		for (const glm::vec2& point : out) {
+			while (i < points.size() && !same(points[i], point))
+				i++;
+			if (i == points.size())
+				return {};
+
+			indices.push_back(i++);
+		}
+
+		return indices;
+	}
+
+	std::vector<glm::vec2> make_series(size_t count, float step, std::mt19937& random) {
+		std::uniform_real_distribution<float> noise(-1.f, 1.f);
+
+		std::vector<glm::vec2> points(count);
+		float y = 0.f;
+		for (size_t i = 0; i < count; i++) {
+			y += noise(random);
+			points[i] = { (float)i * step, y };
+		}
+
+		return points;
+	}
+
+	std::vector<glm::vec2> make_walk(size_t count, std::mt19937& random) {
+		std::uniform_real_distribution<float> noise(-1.f, 1.f);
+
+		std::vector<glm::vec2> points(count);
+		glm::vec2 position{ 0.f, 0.f };
+		for (glm::vec2& point : points) {
+			position = { position.x + noise(random), position.y + noise(random) };
+			point = position;
+		}
+
+		return points;
+	}
+
+	// Distance to the line through a and b, or to a when they're the same point, like rdp measures it
+	float line_distance(const glm::vec2& p, const glm::vec2& a, const glm::vec2& b) {
+		const glm::vec2 d = b - a;
+		const glm::vec2 v = p - a;
+		const float length = std::sqrt(d.x * d.x + d.y * d.y);
+		if (length == 0.f)
+			return std::sqrt(v.x * v.x + v.y * v.y);
+
+		return std::abs(v.x * d.y - v.y * d.x) / length;
+	}
+
+	void check_rdp_tolerance(const std::vector<glm::vec2>& points, float tolerance) {
+		std::vector<glm::vec2> out;
+		renderer::decimate_rdp(points, tolerance, out);
+
+		const std::vector<size_t> indices = match_indices(points, out);
+		CHECK(indices.size() == out.size());
+		if (indices.size() < 2 || indices.size() != out.size())
+			return;
+
+		CHECK(indices.front() == 0);
+		CHECK(indices.back() == points.size() - 1);
+
+		// Small slack for the float error of the squared distances
+		const float limit = tolerance * 1.001f + 1e-5f;
+		float worst = 0.f;
+		for (size_t segment = 0; segment + 1 < indices.size(); segment++) {
+			const glm::vec2& a = points[indices[segment]];
+			const glm::vec2& b = points[indices[segment + 1]];
+			for (size_t i = indices[segment] + 1; i < indices[segment + 1]; i++)
+				worst = std::max(worst, line_distance(points[i], a, b));
+		}
+
+		CHECK(worst <= limit);
+	}
+
+	void test_min_max_extents() {
+		std::mt19937 random(7);
+
+		for (const float step : { 0.01f, 0.37f, 1.f }) {
+			const std::vector<glm::vec2> points = make_series(20000, step, random);
+
+			for (const float width : { 0.5f, 1.f, 7.f }) {
+				std::vector<glm::vec2> out;
+				renderer::decimate_min_max(points, width, out);
+
+				const std::vector<size_t> indices = match_indices(points, out);
+				CHECK(indices.size() == out.size());
+				if (indices.size() != out.size())
+					continue;
+
+				CHECK(indices.front() == 0);
+				CHECK(indices.back() == points.size() - 1);
+
+				// Brute force every column's extremes and check the output keeps exactly them plus the column's ends
+				const float origin = points[0].x;
+				size_t first = 0, kept = 0;
+				while (first < points.size()) {
+					const float column = std::floor((points[first].x - origin) / width);
+
+					size_t last = first;
+					float min_y = points[first].y, max_y = points[first].y;
+					while (last + 1 < points.size() && std::floor((points[last + 1].x - origin) / width) == column) {
+						last++;
+						min_y = std::min(min_y, points[last].y);
+						max_y = std::max(max_y, points[last].y);
+					}
+
+					float out_min = std::numeric_limits<float>::max(), out_max = -out_min;
+					size_t in_column = 0;
+					bool has_first = false, has_last = false;
+					for (; kept < indices.size() && indices[kept] <= last; kept++) {
+						CHECK(indices[kept] >= first);
+						out_min = std::min(out_min, out[kept].y);
+						out_max = std::max(out_max, out[kept].y);
+						has_first |= indices[kept] == first;
+						has_last |= indices[kept] == last;
+						in_column++;
+					}
+
+					CHECK(has_first && has_last);
+					CHECK(in_column <= 4);
+					CHECK(out_min == min_y);
+					CHECK(out_max == max_y);
+
+					first = last + 1;
+				}
+			}
+		}
+	}
+
+	void test_rdp_tolerance() {
+		std::mt19937 random(11);
+
+		for (const float tolerance : { 0.05f, 0.5f, 2.f }) {
+			check_rdp_tolerance(make_walk(5000, random), tolerance);
+			check_rdp_tolerance(make_series(5000, 0.1f, random), tolerance);
+		}
+
+		// Dense points on a straight line collapse to the two ends
+		std::vector<glm::vec2> line(1000);
+		for (size_t i = 0; i < line.size(); i++)
+			line[i] = { (float)i, (float)i * 0.5f };
+
+		std::vector<glm::vec2> out;
+		renderer::decimate_rdp(line, 0.01f, out);
+		CHECK(out.size() == 2);
+	}
+
+	void test_short_inputs() {
+		const std::vector<glm::vec2> inputs[] = {
+			{},
+			{ { 1.f, 2.f } },
+			{ { 1.f, 2.f }, { 3.f, -4.f } },
+		};
+
+		for (const std::vector<glm::vec2>& points : inputs) {
+			std::vector<glm::vec2> out{ { 9.f, 9.f } };
+			renderer::decimate_min_max(points, 1.f, out);
+			CHECK(same(out, points));
+
+			out = { { 9.f, 9.f } };
+			renderer::decimate_rdp(points, 1.f, out);
+			CHECK(same(out, points));
+
+			const renderer::decimation_stats stats =
+			renderer::decimate_polyline(points, 1.f, renderer::decimation_mode::automatic, out);
+			CHECK(same(out, points));
+			CHECK(stats.input_points == points.size() && stats.output_points == points.size());
+		}
+	}
+
+	// A tolerance or column width of zero, below zero or NaN passes the input through untouched
+	void test_zero_tolerance() {
+		std::mt19937 random(3);
+		const std::vector<glm::vec2> series = make_series(1000, 0.1f, random);
+		const std::vector<glm::vec2> walk = make_walk(1000, random);
+
+		for (const float tolerance : { 0.f, -1.f, std::numeric_limits<float>::quiet_NaN() }) {
+			std::vector<glm::vec2> out;
+			renderer::decimate_min_max(series, tolerance, out);
+			CHECK(same(out, series));
+
+			renderer::decimate_rdp(walk, tolerance, out);
+			CHECK(same(out, walk));
+		}
+	}
+
+	// Paths whose ends meet have no line to measure against, points are measured from the shared end instead
+	void test_collapsed_segment() {
+		const std::vector<glm::vec2> square = {
+			{ 0.f, 0.f }, { 5.f, 0.f }, { 5.f, 5.f }, { 0.f, 5.f }, { 0.f, 0.f },
+		};
+
+		std::vector<glm::vec2> out;
+		renderer::decimate_rdp(square, 1.f, out);
+		CHECK(same(out, square));
+
+		// Measured as a plain distance from the shared end, so the tolerance decides right at its edge
+		const std::vector<glm::vec2> near = { { 0.f, 0.f }, { 0.9f, 0.f }, { 0.f, 0.f } };
+		const std::vector<glm::vec2> far = { { 0.f, 0.f }, { 1.1f, 0.f }, { 0.f, 0.f } };
+		renderer::decimate_rdp(near, 1.f, out);
+		CHECK(out.size() == 2);
+		renderer::decimate_rdp(far, 1.f, out);
+		CHECK(same(out, far));
+
+		std::vector<glm::vec2> loop(400);
+		for (size_t i = 0; i < loop.size(); i++) {
+			const float angle = (float)i / (float)(loop.size() - 1) * 6.2831853f;
+			loop[i] = { std::cos(angle) * 10.f, std::sin(angle) * 10.f };
+		}
+		loop.back() = loop.front();
+
+		check_rdp_tolerance(loop, 0.25f);
+		renderer::decimate_rdp(loop, 0.25f, out);
+		CHECK(out.size() > 4 && out.size() < loop.size());
+
+		// Every point the same, nothing but the ends survives
+		const std::vector<glm::vec2> point(50, glm::vec2{ 2.f, 3.f });
+		renderer::decimate_rdp(point, 0.1f, out);
+		CHECK(out.size() == 2);
+	}
+
+	void test_automatic_mode() {
+		std::mt19937 random(5);
+		const std::vector<glm::vec2> series = make_series(2000, 0.1f, random);
+		const std::vector<glm::vec2> walk = make_walk(2000, random);
+
+		CHECK(renderer::is_monotonic_x(series));
+		CHECK(!renderer::is_monotonic_x(walk));
+
+		std::vector<glm::vec2> automatic, expected;
+		renderer::decimate_polyline(series, 1.f, renderer::decimation_mode::automatic, automatic);
+		renderer::decimate_min_max(series, 1.f, expected);
+		CHECK(same(automatic, expected));
+
+		const renderer::decimation_stats stats =
+		renderer::decimate_polyline(walk, 1.f, renderer::decimation_mode::automatic, automatic);
+		renderer::decimate_rdp(walk, 1.f, expected);
+		CHECK(same(automatic, expected));
+		CHECK(stats.input_points == walk.size() && stats.output_points == automatic.size());
+	}
+}// namespace
+
+int main() {
+	test_min_max_extents();
+	test_rdp_tolerance();
+	test_short_inputs();
+	test_zero_tolerance();
+	test_collapsed_segment();
+	test_automatic_mode();
+
+	return renderer::test::check_result();
+}
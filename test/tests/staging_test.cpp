@@ -0,0 +1,115 @@
+#include "check.hpp"
+
+#include <renderer/util/staging.hpp>
+
+#include <cstring>
+#include <vector>
+
+// plan_staging offsets and staging_copier results checked against plain memory, no device involved
+namespace {
+	constexpr std::byte untouched{ 0xCD };
+
+	struct chunk_data {
+		std::vector<std::byte> vertices;
+		std::vector<std::byte> indices;
+	};
+
+	std::vector<std::byte> make_bytes(size_t size, uint8_t seed) {
+		std::vector<std::byte> bytes(size);
+		for (size_t i = 0; i < size; i++)
+			bytes[i] = std::byte((uint8_t)(i * 31 + seed));
+		return bytes;
+	}
+
+	void test_plan_offsets() {
+		const size_t vertices_sizes[] = { 96, 0, 4000, 12, 7 };
+		const size_t indices_sizes[] = { 24, 12, 0, 36, 1 };
+
+		std::vector<renderer::staging_chunk> chunks(std::size(vertices_sizes));
+		for (size_t i = 0; i < chunks.size(); i++) {
+			chunks[i].vertices_size = vertices_sizes[i];
+			chunks[i].indices_size = indices_sizes[i];
+		}
+
+		const renderer::staging_totals base{ 1000, 300 };
+		const renderer::staging_totals totals = renderer::plan_staging(chunks, base);
+
+		size_t vertices_offset = base.vertices_size, indices_offset = base.indices_size;
+		for (size_t i = 0; i < chunks.size(); i++) {
+			CHECK(chunks[i].vertices_offset == vertices_offset);
+			CHECK(chunks[i].indices_offset == indices_offset);
+			vertices_offset += vertices_sizes[i];
+			indices_offset += indices_sizes[i];
+		}
+
+		CHECK(totals.vertices_size == vertices_offset);
+		CHECK(totals.indices_size == indices_offset);
+
+		const renderer::staging_totals empty = renderer::plan_staging({}, base);
+		CHECK(empty.vertices_size == base.vertices_size && empty.indices_size == base.indices_size);
+	}
+
+	// Copies the chunks after a gap of base bytes and checks every byte of both destinations, the gap and the tail
+	// past the last chunk have to stay untouched
+	void test_copy(const std::vector<size_t>& vertices_sizes, const std::vector<size_t>& indices_sizes) {
+		std::vector<chunk_data> data(vertices_sizes.size());
+		std::vector<renderer::staging_chunk> chunks(vertices_sizes.size());
+		for (size_t i = 0; i < chunks.size(); i++) {
+			data[i].vertices = make_bytes(vertices_sizes[i], (uint8_t)(i * 2));
+			data[i].indices = make_bytes(indices_sizes[i], (uint8_t)(i * 2 + 1));
+			chunks[i] = { .vertices = data[i].vertices.data(),
+						  .vertices_size = vertices_sizes[i],
+						  .indices = data[i].indices.data(),
+						  .indices_size = indices_sizes[i] };
+		}
+
+		const renderer::staging_totals base{ 64, 32 };
+		const renderer::staging_totals totals = renderer::plan_staging(chunks, base);
+
+		constexpr size_t tail = 256;
+		std::vector<std::byte> vertices_dst(totals.vertices_size + tail, untouched);
+		std::vector<std::byte> indices_dst(totals.indices_size + tail, untouched);
+
+		renderer::staging_copier copier;
+		copier.copy(chunks, vertices_dst.data(), indices_dst.data());
+
+		for (size_t i = 0; i < chunks.size(); i++) {
+			CHECK(!memcmp(vertices_dst.data() + chunks[i].vertices_offset, data[i].vertices.data(),
+						  data[i].vertices.size()));
+			CHECK(!memcmp(indices_dst.data() + chunks[i].indices_offset, data[i].indices.data(),
+						  data[i].indices.size()));
+		}
+
+		const auto is_untouched = [](const std::byte* first, size_t size) {
+			for (size_t i = 0; i < size; i++) {
+				if (first[i] != untouched)
+					return false;
+			}
+			return true;
+		};
+
+		CHECK(is_untouched(vertices_dst.data(), base.vertices_size));
+		CHECK(is_untouched(indices_dst.data(), base.indices_size));
+		CHECK(is_untouched(vertices_dst.data() + totals.vertices_size, tail));
+		CHECK(is_untouched(indices_dst.data() + totals.indices_size, tail));
+	}
+}// namespace
+
+int main() {
+	constexpr size_t slice = renderer::staging_copier::slice_size;
+	constexpr size_t threshold = renderer::staging_copier::parallel_threshold;
+
+	test_plan_offsets();
+
+	// Below the parallel threshold, copied on the calling thread
+	test_copy({ 96, 0, 4000 }, { 24, 12, 0 });
+
+	// Slices of exactly slice_size, one byte over and one short, still below the threshold
+	test_copy({ slice, slice + 1, slice - 1 }, { 12, slice, 0 });
+
+	// Over the threshold so slices go to the job system, sizes straddle slice boundaries
+	test_copy({ threshold + 1, 3 * slice + 7, 0, 5 }, { slice * 2 + 3, threshold, 17, 0 });
+	test_copy({ 4 * threshold + 123 }, { 0 });
+
+	return renderer::test::check_result();
+}
@@ -0,0 +1,59 @@
+#include "renderer/util/compression.hpp"
+
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+// Compresses a binary (usually a TTF) into a C++ array that can be passed to
+// font_atlas::add_font_from_memory_compressed_ttf
+//
+// Usage: binary_to_compressed [-nocompress] <input> <symbol> [output]
+int main(int argc, char** argv) {
+	bool compress = true;
+	int arg = 1;
+	if (arg < argc && std::string(argv[arg]) == "-nocompress") {
+		compress = false;
+		arg++;
+	}
+
+	if (argc - arg < 2) {
+		fprintf(stderr, "Usage: %s [-nocompress] <input> <symbol> [output]\n", argv[0]);
+		return 1;
+	}
+
+	const char* input_filename = argv[arg];
+	const char* symbol = argv[arg + 1];
+	const char* output_filename = argc - arg > 2 ? argv[arg + 2] : nullptr;
+
+	std::ifstream input(input_filename, std::ios::in | std::ios::binary);
+	if (!input.is_open()) {
+		fprintf(stderr, "Failed to open %s\n", input_filename);
+		return 1;
+	}
+
+	const std::vector<uint8_t> data{ std::istreambuf_iterator<char>(input), std::istreambuf_iterator<char>() };
+	const std::vector<uint8_t> output_data = compress ? renderer::compress_binary(data) : data;
+
+	FILE* output = output_filename ? fopen(output_filename, "w") : stdout;
+	if (!output) {
+		fprintf(stderr, "Failed to open %s\n", output_filename);
+		return 1;
+	}
+
+	fprintf(output, "// File: '%s' (%zu bytes)\n", input_filename, data.size());
+	if (compress)
+		fprintf(output, "// Compressed with binary_to_compressed (LZ4, %zu bytes)\n", output_data.size());
+
+	fprintf(output, "#pragma once\n\n#include <cstdint>\n\n");
+	fprintf(output, "alignas(4) static const uint8_t %s_data[%zu] = {", symbol, output_data.size());
+	for (size_t i = 0; i < output_data.size(); i++)
+		fprintf(output, i % 24 ? "0x%02x," : "\n\t0x%02x,", output_data[i]);
+	fprintf(output, "\n};\n");
+
+	if (output != stdout)
+		fclose(output);
+
+	return 0;
+}